@@ -12,85 +12,265 @@
 #define MAX_ITERATIONS 100000
 #define STUCK_THRESHOLD 100  // Define how many iterations of no improvement is considered 'stuck'
 
+// Cooling schedules
+#define SCHEDULE_GEOMETRIC 0         // temperature *= ALPHA every iteration
+#define SCHEDULE_ACCEPTANCE 1        // Feedback controller tracking a target acceptance probability
+#define SCHEDULE_REHEAT 2            // Geometric cooling, reheated after REHEAT_THRESHOLD stuck occurrences
+#define SCHEDULE_TIME_BUDGET 3       // Geometric cooling stretched to fit TIME_BUDGET seconds
+#define SCHEDULE SCHEDULE_GEOMETRIC
+#define TARGET_ACCEPTANCE_START 0.5  // Target mean acceptance probability at the first iteration
+#define TARGET_ACCEPTANCE_END 0.01   // Target mean acceptance probability at the last iteration
+#define ACCEPTANCE_WINDOW 500        // Iterations of the acceptance trace averaged by the controller
+#define CONTROLLER_GAIN 2.0          // How strongly the controller corrects the temperature
+#define REHEAT_THRESHOLD 20          // Stuck occurrences without a new best before reheating
+#define REHEAT_RATIO 0.5             // Reheat to this fraction of the temperature of the last new best
+#define TIME_BUDGET 1.0              // Wall-clock seconds available to SCHEDULE_TIME_BUDGET
+#define BUDGET_FINAL_TEMPERATURE 0.1 // Temperature reached when the time budget runs out
+#define CANONICAL_PLANE_DIAGONALS 2  // evaluate() checks the diagonals of every slice
+#define ARCHIVE 1                    // 1: store the final cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes.arc"     // Archive of final cubes shared by all solvers
+#define WARM_START 0                 // 1: start from one of the best archived cubes instead of a random one
+#define WARM_START_TOP_K 10          // Number of best archived cubes to pick the start from
+#define TEXT_TRACE 0                 // 1: also write the old acceptance_probs.txt text trace
+#define PROPOSALS 8                  // Swaps scored together from the line sums, 1: copy and evaluate each neighbour
+#define NUM_LINES (3 * N * N + 2 + 6 * N)  // Lines checked by evaluate()
+#define LINES_PER_CELL 13            // Upper bound of the lines through one cell
+#define TELEMETRY 1                  // 1: publish progress in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 1000      // Iterations between two publishes
+
+#include "archive.h"
+#include "objective.h"
+#include "trace.h"
+#include "telemetry.h"
+
 // Function prototypes
 void initialize_cube(int cube[N][N][N]);
 void print_cube(int cube[N][N][N]);
+int score_cube(int cube[N][N][N], int absolute);
 int evaluate(int cube[N][N][N]);
+int deviation(int cube[N][N][N]);
 void swap(int *a, int *b);
 void generate_random_neighbor(int cube[N][N][N], int new_cube[N][N][N]);
 void copy_cube(int src[N][N][N], int dest[N][N][N]);
 double acceptance_probability(int current_error, int new_error, double temperature);
+void init_lines(void);
+int evaluate_lines(int cube[N][N][N], int line_sum[NUM_LINES + 1]);
+void score_proposals(int cube[N][N][N], int line_sum[NUM_LINES + 1], int a[], int b[], int delta[]);
+void apply_swap(int cube[N][N][N], int line_sum[NUM_LINES + 1], int a, int b);
+
+// Lines through every cell padded to LINES_PER_CELL with the spare line NUM_LINES, and the line
+// shared by two cells (-1 if none), built once by init_lines() for the multi-proposal step
+int cell_lines[TOTAL_NUMBERS][LINES_PER_CELL];
+int cell_num_lines[TOTAL_NUMBERS];
+int line_cells[NUM_LINES][N];
+int line_class[NUM_LINES + 1];  // Objective class of every line, the spare line counts as straight
+short shared_line[TOTAL_NUMBERS][TOTAL_NUMBERS];
 
 int main() {
     clock_t start_time = clock();
-    srand(time(0));
+    struct timespec wall_start, wall_now;  // Wall clock of SCHEDULE_TIME_BUDGET
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    unsigned int seed = (unsigned int)time(0);
+    srand(seed);
 
     int current_cube[N][N][N];
     int new_cube[N][N][N];
-    int current_error, new_error;
+    int best_cube[N][N][N];
+    int current_error, new_error, best_error;
+    int line_sum[NUM_LINES + 1];  // Line sums for the multi-proposal step, the spare line stays magic
+    int proposal_a[PROPOSALS], proposal_b[PROPOSALS], proposal_delta[PROPOSALS];
+    int next_proposal = PROPOSALS;  // Next scored proposal to test, PROPOSALS: score a new batch
     double temperature = INITIAL_TEMPERATURE;
 
-    // Initialize the cube with random values
-    initialize_cube(current_cube);
+    // Initialize the cube with random values (or an archived cube)
+    if (!WARM_START || !archive_warm_start(ARCHIVE_FILE, WARM_START_TOP_K, current_cube)) {
+        initialize_cube(current_cube);
+    }
     current_error = evaluate(current_cube);
+    if (PROPOSALS > 1) {
+        init_lines();
+        evaluate_lines(current_cube, line_sum);
+    }
+    copy_cube(current_cube, best_cube);
+    best_error = current_error;
 
     printf("Initial Cube:\n");
     print_cube(current_cube);
     printf("Initial Error: %d\n", current_error);
+    TelemetrySegment *telemetry = TELEMETRY ? telemetry_open("Annealing", 1) : NULL;
 
     int iterations = 0;
     int stuck_count = 0;  // Counter for local optima "stuck" cases
     int no_improvement_count = 0;  // To detect prolonged lack of improvement
-
-    // Array to store acceptance probability values for plotting
-    double acceptance_probs[MAX_ITERATIONS];
+    int stuck_since_best = 0;  // Stuck occurrences since the last new best cube
+    int reheats = 0;
+    double best_temperature = INITIAL_TEMPERATURE;  // Temperature when the best cube was found
+    double window_sum = 0;  // Sum of the last ACCEPTANCE_WINDOW acceptance probabilities
+    double elapsed = 0;
+
+    // Arrays to store the trace for plotting, on the heap since they hold MAX_ITERATIONS values
+    double *acceptance_probs = malloc(sizeof(double) * MAX_ITERATIONS);
+    double *temperatures = malloc(sizeof(double) * MAX_ITERATIONS);
+    int *errors = malloc(sizeof(int) * MAX_ITERATIONS);
     
-    while (temperature > FINAL_TEMPERATURE && iterations < MAX_ITERATIONS) {
+    while (temperature > FINAL_TEMPERATURE && current_error > 0
+           && (SCHEDULE == SCHEDULE_TIME_BUDGET ? elapsed < TIME_BUDGET : iterations < MAX_ITERATIONS)) {
         iterations++;
 
-        // Generate a random neighbor
-        generate_random_neighbor(current_cube, new_cube);
-        new_error = evaluate(new_cube);
-        
-        double prob = acceptance_probability(current_error, new_error, temperature);
-        acceptance_probs[iterations - 1] = prob;  // Store the probability for plotting
-
-        // Accept the new solution if it's better, or with a probability if worse
-        if (new_error < current_error || prob > ((double)rand() / RAND_MAX)) {
-            copy_cube(new_cube, current_cube);
-            current_error = new_error;
-            no_improvement_count = 0;  // Reset count as we've found improvement
+        double prob;
+        if (PROPOSALS > 1) {
+            // Score PROPOSALS random swaps in one pass, then test one of them per iteration. The
+            // scores stay valid until a swap is accepted, which discards the rest of the batch, so
+            // every iteration is still one Metropolis step with its own cooling and trace entry
+            if (next_proposal == PROPOSALS) {
+                for (int k = 0; k < PROPOSALS; k++) {
+                    proposal_a[k] = rand() % TOTAL_NUMBERS;
+                    proposal_b[k] = rand() % TOTAL_NUMBERS;
+                }
+                score_proposals(current_cube, line_sum, proposal_a, proposal_b, proposal_delta);
+                next_proposal = 0;
+            }
+            int k = next_proposal++;
+            prob = acceptance_probability(current_error, current_error + proposal_delta[k], temperature);
+
+            if (proposal_delta[k] < 0 || prob > ((double)rand() / RAND_MAX)) {
+                apply_swap(current_cube, line_sum, proposal_a[k], proposal_b[k]);
+                current_error += proposal_delta[k];
+                no_improvement_count = 0;
+                next_proposal = PROPOSALS;
+            } else {
+                no_improvement_count++;
+            }
         } else {
-            no_improvement_count++;
+            // Generate a random neighbor
+            generate_random_neighbor(current_cube, new_cube);
+            new_error = evaluate(new_cube);
+            prob = acceptance_probability(current_error, new_error, temperature);
+
+            // Accept the new solution if it's better, or with a probability if worse
+            if (new_error < current_error || prob > ((double)rand() / RAND_MAX)) {
+                copy_cube(new_cube, current_cube);
+                current_error = new_error;
+                no_improvement_count = 0;  // Reset count as we've found improvement
+            } else {
+                no_improvement_count++;
+            }
+        }
+        if (iterations <= MAX_ITERATIONS) {
+            acceptance_probs[iterations - 1] = prob;  // Store the probability for plotting
+            temperatures[iterations - 1] = temperature;
+        }
+
+        // Remember the best cube, reheating may move away from it
+        if (current_error < best_error) {
+            copy_cube(current_cube, best_cube);
+            best_error = current_error;
+            best_temperature = temperature;
+            stuck_since_best = 0;
         }
 
         // Check if we've been stuck in local optima for a while
         if (no_improvement_count >= STUCK_THRESHOLD) {
             stuck_count++;
+            stuck_since_best++;
             no_improvement_count = 0;  // Reset to avoid repeated counting
         }
 
         // Cool down the temperature
-        temperature *= ALPHA;
+        if (SCHEDULE == SCHEDULE_ACCEPTANCE) {
+            // Compare the mean of the recent acceptance trace with a target that decays over the run
+            window_sum += prob;
+            if (iterations > ACCEPTANCE_WINDOW && iterations - ACCEPTANCE_WINDOW <= MAX_ITERATIONS) {
+                window_sum -= acceptance_probs[iterations - ACCEPTANCE_WINDOW - 1];
+            }
+            if (iterations % ACCEPTANCE_WINDOW == 0) {
+                double progress = (double)iterations / MAX_ITERATIONS;
+                double target = TARGET_ACCEPTANCE_START * pow(TARGET_ACCEPTANCE_END / TARGET_ACCEPTANCE_START, progress);
+                double observed = window_sum / ACCEPTANCE_WINDOW;
+                temperature *= exp(CONTROLLER_GAIN * (target - observed) / target);
+                if (temperature > INITIAL_TEMPERATURE) {
+                    temperature = INITIAL_TEMPERATURE;
+                }
+            }
+        } else if (SCHEDULE == SCHEDULE_TIME_BUDGET) {
+            // Follow the geometric curve from INITIAL_TEMPERATURE to BUDGET_FINAL_TEMPERATURE over the budget
+            if (iterations % 256 == 0) {
+                clock_gettime(CLOCK_MONOTONIC, &wall_now);
+                elapsed = (wall_now.tv_sec - wall_start.tv_sec) + (wall_now.tv_nsec - wall_start.tv_nsec) / 1e9;
+                temperature = INITIAL_TEMPERATURE * pow(BUDGET_FINAL_TEMPERATURE / INITIAL_TEMPERATURE, elapsed / TIME_BUDGET);
+            }
+        } else {
+            temperature *= ALPHA;
+        }
+
+        // Reheat when the chain has been stuck for too long without a new best
+        if (SCHEDULE == SCHEDULE_REHEAT && stuck_since_best >= REHEAT_THRESHOLD) {
+            temperature = best_temperature * REHEAT_RATIO;
+            best_temperature = temperature;  // The next reheat starts lower
+            stuck_since_best = 0;
+            reheats++;
+        }
+
+        if (iterations <= MAX_ITERATIONS) {
+            errors[iterations - 1] = current_error;
+        }
 
         // Print status every 1000 iterations
         if (iterations % 10000 == 0) {
             printf("Iteration %d - Current Error: %d - Temperature: %.2f\n", iterations, current_error, temperature);
         }
+        if (iterations % TELEMETRY_INTERVAL == 0) {
+            telemetry_publish(telemetry, 0, "annealing", iterations, current_error, best_error, temperature, reheats);
+        }
     }
+    telemetry_publish(telemetry, 0, "annealing", iterations, current_error, best_error, temperature, reheats);
+    telemetry_status(telemetry, 0, TELEMETRY_DONE);
+    telemetry_close(telemetry);
 
     printf("Final Cube after %d iterations:\n", iterations);
-    print_cube(current_cube);
-    printf("Final Error: %d\n", current_error);
+    print_cube(best_cube);
+    int final_error = deviation(best_cube);
+    printf("Final Error: %d\n", final_error);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), best_error);
+    }
+    printf("Canonical Hash: %016llx\n", canonical_hash(best_cube));
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "T0=%g alpha=%g iter=%d sch=%d k=%d", INITIAL_TEMPERATURE, ALPHA, MAX_ITERATIONS, SCHEDULE, PROPOSALS);
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, best_cube, final_error, "Annealing", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
     printf("Total stuck occurrences (local optima): %d\n", stuck_count);
+    if (SCHEDULE == SCHEDULE_REHEAT) {
+        printf("Total reheats: %d\n", reheats);
+    }
 
     // Plotting acceptance probability (to be done outside C or by exporting data)
-    FILE *fptr = fopen("acceptance_probs.txt", "w");
-    for (int i = 0; i < iterations; i++) {
-        fprintf(fptr, "%d %f\n", i + 1, acceptance_probs[i]);
+    int recorded = iterations < MAX_ITERATIONS ? iterations : MAX_ITERATIONS;
+    int *iteration_numbers = malloc(sizeof(int) * (recorded > 0 ? recorded : 1));
+    for (int i = 0; i < recorded; i++) {
+        iteration_numbers[i] = i + 1;
+    }
+    const char *names[] = {"iteration", "probability", "temperature", "error"};
+    const char *dtypes[] = {"<i4", "<f8", "<f8", "<i4"};
+    const void *columns[] = {iteration_numbers, acceptance_probs, temperatures, errors};
+    if (trace_write("acceptance_probs.trc", recorded, 4, names, dtypes, columns)) {
+        printf("Acceptance probabilities saved to 'acceptance_probs.trc'.\n");
     }
-    fclose(fptr);
-    printf("Acceptance probabilities saved to 'acceptance_probs.txt'.\n");
+    if (TEXT_TRACE) {
+        FILE *fptr = fopen("acceptance_probs.txt", "w");
+        for (int i = 0; i < recorded; i++) {
+            fprintf(fptr, "%d %f\n", i + 1, acceptance_probs[i]);
+        }
+        fclose(fptr);
+        printf("Acceptance probabilities saved to 'acceptance_probs.txt'.\n");
+    }
+    free(iteration_numbers);
+    free(acceptance_probs);
+    free(temperatures);
+    free(errors);
     
     // Record the end time
     clock_t end_time = clock();
@@ -99,6 +279,11 @@ int main() {
     double duration = (double)(end_time - start_time) / CLOCKS_PER_SEC;
 
     printf("Program execution time: %.2f seconds\n", duration);
+
+    // Append the trial summary
+    const char *summary_names[] = {"iterations", "time", "final_error", "stuck", "schedule"};
+    double summary[] = {iterations, duration, best_error, stuck_count, SCHEDULE};
+    trace_append_row("annealing_trials.trc", 5, summary_names, summary);
     return 0;
 }
 
@@ -157,8 +342,8 @@ void print_cube(int cube[N][N][N]) {
     }
 }
 
-// Evaluate the error of the cube (difference from MAGIC_NUMBER)
-int evaluate(int cube[N][N][N]) {
+// Score the lines of the cube with the objective, or by |sum - MAGIC_NUMBER| when absolute is set
+int score_cube(int cube[N][N][N], int absolute) {
     int error = 0;
     int sum;
 
@@ -169,7 +354,7 @@ int evaluate(int cube[N][N][N]) {
             for (int k = 0; k < N; k++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -180,7 +365,7 @@ int evaluate(int cube[N][N][N]) {
             for (int i = 0; i < N; i++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -191,7 +376,7 @@ int evaluate(int cube[N][N][N]) {
             for (int j = 0; j < N; j++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -200,13 +385,13 @@ int evaluate(int cube[N][N][N]) {
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][i];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     sum = 0;
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][N - i - 1];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     // Evaluate diagonal in slices
 // Evaluate diagonals in horizontal (x-y) slices
@@ -215,13 +400,13 @@ int evaluate(int cube[N][N][N]) {
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][j];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][N - j - 1];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     // Evaluate diagonals in vertical (y-z) slices
@@ -230,13 +415,13 @@ int evaluate(int cube[N][N][N]) {
         for (int k = 0; k < N; k++) {
             sum += cube[k][j][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int k = 0; k < N; k++) {
             sum += cube[N - k - 1][j][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     // Evaluate diagonals in vertical (x-z) slices
@@ -245,18 +430,28 @@ int evaluate(int cube[N][N][N]) {
         for (int i = 0; i < N; i++) {
             sum += cube[i][i][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int i = 0; i < N; i++) {
             sum += cube[i][N - i - 1][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     return error;
 }
 
+// Objective of the cube, the score the search minimises
+int evaluate(int cube[N][N][N]) {
+    return score_cube(cube, 0);
+}
+
+// Sum of absolute line deviations, the error that is printed and archived
+int deviation(int cube[N][N][N]) {
+    return score_cube(cube, 1);
+}
+
 // Swap two integers
 void swap(int *a, int *b) {
     int temp = *a;
@@ -294,3 +489,110 @@ double acceptance_probability(int current_error, int new_error, double temperatu
     }
     return exp((double)(current_error - new_error) / temperature);
 }
+
+// Add a line given its first cell and the step between consecutive cells
+void add_line(int *num_lines, int i, int j, int k, int di, int dj, int dk) {
+    for (int s = 0; s < N; s++) {
+        int cell = (i + s * di) * N * N + (j + s * dj) * N + (k + s * dk);
+        line_cells[*num_lines][s] = cell;
+        cell_lines[cell][cell_num_lines[cell]++] = *num_lines;
+    }
+    (*num_lines)++;
+}
+
+// Build the line tables in the same order as evaluate()
+void init_lines(void) {
+    int num_lines = 0;
+    for (int i = 0; i < N; i++) for (int j = 0; j < N; j++) add_line(&num_lines, i, j, 0, 0, 0, 1);
+    for (int j = 0; j < N; j++) for (int k = 0; k < N; k++) add_line(&num_lines, 0, j, k, 1, 0, 0);
+    for (int i = 0; i < N; i++) for (int k = 0; k < N; k++) add_line(&num_lines, i, 0, k, 0, 1, 0);
+    add_line(&num_lines, 0, 0, 0, 1, 1, 1);
+    add_line(&num_lines, 0, 0, N - 1, 1, 1, -1);
+    for (int i = 0; i < N; i++) {
+        add_line(&num_lines, i, 0, 0, 0, 1, 1);
+        add_line(&num_lines, i, 0, N - 1, 0, 1, -1);
+    }
+    for (int j = 0; j < N; j++) {
+        add_line(&num_lines, 0, j, 0, 1, 0, 1);
+        add_line(&num_lines, N - 1, j, 0, -1, 0, 1);
+    }
+    for (int k = 0; k < N; k++) {
+        add_line(&num_lines, 0, 0, k, 1, 1, 0);
+        add_line(&num_lines, 0, N - 1, k, 1, -1, 0);
+    }
+
+    for (int l = 0; l <= NUM_LINES; l++) {
+        line_class[l] = objective_line_class(l, N);
+    }
+
+    // Pad every cell to LINES_PER_CELL lines so the scoring loop has a fixed trip count
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        for (int l = cell_num_lines[c]; l < LINES_PER_CELL; l++) {
+            cell_lines[c][l] = NUM_LINES;
+        }
+    }
+    for (int a = 0; a < TOTAL_NUMBERS; a++) {
+        for (int b = 0; b < TOTAL_NUMBERS; b++) {
+            shared_line[a][b] = -1;
+        }
+    }
+    for (int l = 0; l < NUM_LINES; l++) {
+        for (int s = 0; s < N; s++) {
+            for (int t = 0; t < N; t++) {
+                if (s != t) shared_line[line_cells[l][s]][line_cells[l][t]] = l;
+            }
+        }
+    }
+}
+
+// Objective of the cube, remembering the sum of every line
+int evaluate_lines(int cube[N][N][N], int line_sum[NUM_LINES + 1]) {
+    const int *cells = &cube[0][0][0];
+    int error = 0;
+    for (int l = 0; l < NUM_LINES; l++) {
+        line_sum[l] = 0;
+        for (int s = 0; s < N; s++) {
+            line_sum[l] += cells[line_cells[l][s]];
+        }
+        error += objective_cost(line_sum[l] - MAGIC_NUMBER, line_class[l]);
+    }
+    line_sum[NUM_LINES] = MAGIC_NUMBER;
+    return error;
+}
+
+// Objective change of PROPOSALS swaps a[k] <-> b[k], scored together with branch-free fixed-length
+// loops over the padded line lists. A padding line is magic and straight, so it adds the change of
+// a straight line moved off by diff, which is taken back, and a line through both cells keeps its
+// sum, so its two changes are taken back too. The objective is fixed at build time, so
+// objective_line_delta() puts no branch in the loop.
+void score_proposals(int cube[N][N][N], int line_sum[NUM_LINES + 1], int a[], int b[], int delta[]) {
+    const int *cells = &cube[0][0][0];
+
+    for (int k = 0; k < PROPOSALS; k++) {
+        int diff = cells[b[k]] - cells[a[k]];
+        int d = 0;
+        for (int l = 0; l < LINES_PER_CELL; l++) {
+            int la = cell_lines[a[k]][l], lb = cell_lines[b[k]][l];
+            d += objective_line_delta(line_sum[la] - MAGIC_NUMBER, diff, line_class[la]);
+            d += objective_line_delta(line_sum[lb] - MAGIC_NUMBER, -diff, line_class[lb]);
+        }
+        d -= (LINES_PER_CELL - cell_num_lines[a[k]]) * objective_line_delta(0, diff, OBJECTIVE_STRAIGHT);
+        d -= (LINES_PER_CELL - cell_num_lines[b[k]]) * objective_line_delta(0, -diff, OBJECTIVE_STRAIGHT);
+
+        int shared = shared_line[a[k]][b[k]];
+        if (shared >= 0) {
+            int s = line_sum[shared] - MAGIC_NUMBER;
+            d -= objective_line_delta(s, diff, line_class[shared]) + objective_line_delta(s, -diff, line_class[shared]);
+        }
+        delta[k] = d;
+    }
+}
+
+// Swap cells a and b and update the line sums through them
+void apply_swap(int cube[N][N][N], int line_sum[NUM_LINES + 1], int a, int b) {
+    int *cells = &cube[0][0][0];
+    int diff = cells[b] - cells[a];
+    for (int l = 0; l < cell_num_lines[a]; l++) line_sum[cell_lines[a][l]] += diff;
+    for (int l = 0; l < cell_num_lines[b]; l++) line_sum[cell_lines[b][l]] -= diff;
+    swap(&cells[a], &cells[b]);
+}
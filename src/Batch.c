@@ -0,0 +1,590 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "cube.h"
+
+#define NUM_THREADS 4           // Size of the worker pool
+#define QUEUE_SIZE 64           // Jobs read ahead of the workers
+#define MAX_LINE 1024           // Longest accepted job line
+#define ARENA_CAPACITY (4UL << 30)      // Address space reserved per worker, pages are taken on first use
+#define MEMORY_PAGES ARENA_PAGES_TRANSPARENT  // Page kind of the worker arenas
+#define TELEMETRY 1             // 1: publish the job of every worker in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 4096 // Moves of the random-swap climbers between two publishes, a power of two
+
+#include "telemetry.h"
+
+// One solve request, read from a JSON line such as
+// {"id": "a1", "algorithm": "annealing", "n": 5, "seed": 42, "budget": 100000, "alpha": 0.999}
+typedef struct {
+    char id[64];
+    char algorithm[16];
+    int n;
+    unsigned long long seed;
+    long long budget;           // Iterations (moves) for the climbers, generations for the GA
+    int diagonals;              // Plane diagonals checked, like PLANE_DIAGONALS in Exact.c
+    double initial_temperature;
+    double alpha;
+    int max_sideways;
+    int max_restarts;
+    int population;
+    double mutation_rate;
+    double memory_limit;        // Most scratch memory in MiB the job may use, 0 for no limit
+} Job;
+
+// Reusable scratch memory of one worker, carved from its own arena and rebuilt only when
+// a job of a different shape or a larger population arrives
+typedef struct {
+    Arena arena;
+    Cube current;
+    Cube best;
+    Cube *population;
+    Cube *new_population;
+    int population_capacity;
+    int n;
+    int diagonals;
+    int worker;                 // Telemetry slot of the worker
+} Scratch;
+
+// Result of one job
+typedef struct {
+    long long error;
+    long long iterations;
+    int restarts;
+} Result;
+
+// Bounded job queue between the reader and the workers
+Job queue[QUEUE_SIZE];
+int queue_head = 0, queue_tail = 0, queue_count = 0, input_done = 0;
+pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t queue_not_full = PTHREAD_COND_INITIALIZER;
+pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+TelemetrySegment *telemetry;  // One slot per worker, labelled with the id of its current job
+
+// Function prototypes
+int parse_job(const char *line, Job *job, long long line_number);
+void *worker_main(void *arg);
+size_t scratch_bytes(const Job *job, int population);
+int prepare_scratch(Scratch *scratch, const Job *job);
+void free_scratch(Scratch *scratch);
+Result run_steepest(Scratch *scratch, const Job *job, unsigned long long *rng);
+Result run_stochastic(Scratch *scratch, const Job *job, unsigned long long *rng);
+Result run_annealing(Scratch *scratch, const Job *job, unsigned long long *rng);
+Result run_genetic(Scratch *scratch, const Job *job, unsigned long long *rng);
+void write_result(const Job *job, const Result *result, const Cube *best, double duration, size_t memory);
+void publish_job(const Scratch *scratch, const Job *job, const Result *result, long long current, long long best,
+                 double temperature);
+
+int main(int argc, char *argv[]) {
+    FILE *input = stdin;
+    if (argc > 1) {
+        input = fopen(argv[1], "r");
+        if (input == NULL) {
+            printf("Error opening file!\n");
+            exit(1);
+        }
+    }
+
+    pthread_t threads[NUM_THREADS];
+    int ids[NUM_THREADS];
+    telemetry = TELEMETRY ? telemetry_open("Batch", NUM_THREADS) : NULL;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        ids[t] = t;
+        pthread_create(&threads[t], NULL, worker_main, &ids[t]);
+    }
+
+    // Read jobs and hand them to the pool, blocking while the queue is full
+    char line[MAX_LINE];
+    long long line_number = 0;
+    while (fgets(line, sizeof(line), input) != NULL) {
+        Job job;
+        line_number++;
+        if (!parse_job(line, &job, line_number)) {
+            continue;
+        }
+
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == QUEUE_SIZE) {
+            pthread_cond_wait(&queue_not_full, &queue_lock);
+        }
+        queue[queue_tail] = job;
+        queue_tail = (queue_tail + 1) % QUEUE_SIZE;
+        queue_count++;
+        pthread_cond_signal(&queue_not_empty);
+        pthread_mutex_unlock(&queue_lock);
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    input_done = 1;
+    pthread_cond_broadcast(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    telemetry_close(telemetry);
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
+
+// Find the value of a key in a flat JSON object, returns NULL if it is missing. Only a string
+// right after '{' or ',' followed by ':' is a key, string values are skipped whole, so a value
+// such as "n" never matches the key n
+const char *find_key(const char *line, const char *key) {
+    size_t key_length = strlen(key);
+    int key_position = 0;
+
+    for (const char *p = line; *p != '\0'; p++) {
+        if (*p == '{' || *p == ',') {
+            key_position = 1;
+        } else if (*p == '"') {
+            const char *start = ++p;
+            while (*p != '\0' && *p != '"') {
+                if (*p == '\\' && p[1] != '\0') p++;
+                p++;
+            }
+            if (*p == '\0') {
+                return NULL;
+            }
+            const char *value = p + 1;
+            while (*value == ' ' || *value == '\t') value++;
+            if (key_position && *value == ':' && (size_t)(p - start) == key_length
+                && strncmp(start, key, key_length) == 0) {
+                value++;
+                while (*value == ' ' || *value == '\t') value++;
+                return value;
+            }
+            key_position = 0;
+        } else if (*p != ' ' && *p != '\t') {
+            key_position = 0;
+        }
+    }
+    return NULL;
+}
+
+// Read a number value, keeping the default if the key is missing
+double read_number(const char *line, const char *key, double fallback) {
+    const char *p = find_key(line, key);
+    return p != NULL ? strtod(p, NULL) : fallback;
+}
+
+// Read a string (or bare number) value, keeping the default if the key is missing
+void read_string(const char *line, const char *key, char *out, size_t size, const char *fallback) {
+    const char *p = find_key(line, key);
+    size_t length = 0;
+
+    if (p == NULL) {
+        snprintf(out, size, "%s", fallback);
+        return;
+    }
+    if (*p == '"') {
+        // Quoted string, \" and \\ stand for the character itself
+        p++;
+        while (*p != '\0' && *p != '"' && length + 1 < size) {
+            if (*p == '\\' && p[1] != '\0') p++;
+            out[length++] = *p++;
+        }
+        out[length] = '\0';
+        return;
+    } else {
+        while (p[length] != '\0' && p[length] != ',' && p[length] != '}' && p[length] != ' '
+               && p[length] != '\n' && length + 1 < size) length++;
+    }
+    memcpy(out, p, length);
+    out[length] = '\0';
+}
+
+// Print text as a quoted JSON string, escaping quotes, backslashes and control characters
+void print_json_string(const char *text) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') printf("\\%c", *c);
+        else if (*c < 0x20) printf("\\u%04x", *c);
+        else putchar(*c);
+    }
+    putchar('"');
+}
+
+// Parse one job line, the defaults are the #defines of the single-run programs
+int parse_job(const char *line, Job *job, long long line_number) {
+    if (strchr(line, '{') == NULL) {
+        return 0;  // Blank line or comment
+    }
+
+    char fallback_id[32];
+    snprintf(fallback_id, sizeof(fallback_id), "%lld", line_number);
+    read_string(line, "id", job->id, sizeof(job->id), fallback_id);
+    read_string(line, "algorithm", job->algorithm, sizeof(job->algorithm), "annealing");
+    job->n = (int)read_number(line, "n", 5);
+    job->seed = (unsigned long long)read_number(line, "seed", (double)time(NULL) + line_number);
+    job->diagonals = (int)read_number(line, "diagonals", 2);
+    job->initial_temperature = read_number(line, "t0", 1000.0);
+    job->alpha = read_number(line, "alpha", 0.999);
+    job->max_sideways = (int)read_number(line, "max_sideways", 5000);
+    job->max_restarts = (int)read_number(line, "max_restarts", 10);
+    job->population = (int)read_number(line, "population", 100);
+    job->mutation_rate = read_number(line, "mutation_rate", 0.05);
+    job->memory_limit = read_number(line, "memory_limit", 0);
+
+    long long default_budget = 100000;
+    if (strcmp(job->algorithm, "genetic") == 0) default_budget = 100;
+    else if (strcmp(job->algorithm, "steepest") == 0 || strcmp(job->algorithm, "sideways") == 0) default_budget = 10000;
+    else if (strcmp(job->algorithm, "restart") == 0) default_budget = 500;
+    job->budget = (long long)read_number(line, "budget", (double)default_budget);
+
+    if (job->n < 1 || job->n > CUBE_MAX_ORDER || job->population < 3) {
+        pthread_mutex_lock(&output_lock);
+        printf("{\"id\": ");
+        print_json_string(job->id);
+        printf(", \"status\": \"error\", \"message\": \"invalid n or population\"}\n");
+        fflush(stdout);
+        pthread_mutex_unlock(&output_lock);
+        return 0;
+    }
+    return 1;
+}
+
+// Worker loop: take jobs until the input is exhausted
+void *worker_main(void *arg) {
+    Scratch scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    scratch.worker = *(int *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == 0 && !input_done) {
+            pthread_cond_wait(&queue_not_empty, &queue_lock);
+        }
+        if (queue_count == 0) {
+            pthread_mutex_unlock(&queue_lock);
+            break;
+        }
+        Job job = queue[queue_head];
+        queue_head = (queue_head + 1) % QUEUE_SIZE;
+        queue_count--;
+        pthread_cond_signal(&queue_not_full);
+        pthread_mutex_unlock(&queue_lock);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        int prepared = prepare_scratch(&scratch, &job);
+        if (prepared <= 0) {
+            pthread_mutex_lock(&output_lock);
+            printf("{\"id\": ");
+            print_json_string(job.id);
+            printf(", \"status\": \"error\", \"message\": \"%s\"}\n",
+                   prepared < 0 ? "memory limit exceeded" : "out of memory");
+            fflush(stdout);
+            pthread_mutex_unlock(&output_lock);
+            continue;
+        }
+
+        unsigned long long rng;
+        cube_seed(&rng, job.seed);
+
+        Result result;
+        int known = 1;
+        if (strcmp(job.algorithm, "steepest") == 0 || strcmp(job.algorithm, "sideways") == 0
+            || strcmp(job.algorithm, "restart") == 0) {
+            result = run_steepest(&scratch, &job, &rng);
+        } else if (strcmp(job.algorithm, "stochastic") == 0) {
+            result = run_stochastic(&scratch, &job, &rng);
+        } else if (strcmp(job.algorithm, "annealing") == 0) {
+            result = run_annealing(&scratch, &job, &rng);
+        } else if (strcmp(job.algorithm, "genetic") == 0) {
+            result = run_genetic(&scratch, &job, &rng);
+        } else {
+            known = 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double duration = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        if (known) {
+            publish_job(&scratch, &job, &result, result.error, result.error, 0);
+            telemetry_status(telemetry, scratch.worker, TELEMETRY_IDLE);
+            write_result(&job, &result, &scratch.best, duration, scratch.arena.used);
+        } else {
+            pthread_mutex_lock(&output_lock);
+            printf("{\"id\": ");
+            print_json_string(job.id);
+            printf(", \"status\": \"error\", \"message\": \"unknown algorithm\"}\n");
+            fflush(stdout);
+            pthread_mutex_unlock(&output_lock);
+        }
+    }
+
+    telemetry_status(telemetry, scratch.worker, TELEMETRY_DONE);
+    free_scratch(&scratch);
+    return NULL;
+}
+
+// Arena bytes the scratch of a job takes (the allocations of prepare_scratch, each rounded up
+// to its cache lines), known before anything is allocated
+size_t scratch_bytes(const Job *job, int population) {
+    #define ALIGNED(bytes) (((bytes) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+    int n = job->n, total = n * n * n;
+    int *count = calloc(total, sizeof(int));
+    if (count == NULL) {
+        return 0;
+    }
+    size_t lines = cube_build_lines(n, job->diagonals, count, NULL, NULL, NULL);
+    free(count);
+
+    size_t cube = ALIGNED(sizeof(int) * total) + 2 * ALIGNED(sizeof(int) * (total + 1))
+                + 2 * ALIGNED(sizeof(int) * lines * n) + ALIGNED(sizeof(long long) * lines);
+    size_t bytes = 2 * ALIGNED(sizeof(Cube) * population) + (2 + 2 * (size_t)population) * cube;
+    #undef ALIGNED
+    return bytes;
+}
+
+// Make sure the scratch cubes match the job, rebuilding them in the worker's arena when the
+// shape changes. The worker thread writes every page itself, so they sit on its NUMA node.
+// Returns 0 when out of memory and -1 when the job needs more than its memory limit
+int prepare_scratch(Scratch *scratch, const Job *job) {
+    int population = strcmp(job->algorithm, "genetic") == 0 ? job->population : 0;
+
+    // Refuse the job before any of its memory is taken
+    if (job->memory_limit > 0 && scratch_bytes(job, population) > job->memory_limit * (1 << 20)) {
+        return -1;
+    }
+    if (scratch->arena.base == NULL && !arena_create(&scratch->arena, ARENA_CAPACITY, MEMORY_PAGES)) {
+        return 0;
+    }
+
+    if (scratch->n != job->n || scratch->diagonals != job->diagonals || population > scratch->population_capacity) {
+        arena_reset(&scratch->arena);
+        scratch->n = 0;
+        scratch->population_capacity = 0;
+        scratch->population = arena_alloc(&scratch->arena, sizeof(Cube) * population);
+        scratch->new_population = arena_alloc(&scratch->arena, sizeof(Cube) * population);
+        if (scratch->population == NULL || scratch->new_population == NULL
+            || !cube_init_in(&scratch->current, job->n, job->diagonals, &scratch->arena)
+            || !cube_init_in(&scratch->best, job->n, job->diagonals, &scratch->arena)) {
+            return 0;
+        }
+        for (int i = 0; i < population; i++) {
+            if (!cube_init_in(&scratch->population[i], job->n, job->diagonals, &scratch->arena)
+                || !cube_init_in(&scratch->new_population[i], job->n, job->diagonals, &scratch->arena)) {
+                return 0;
+            }
+        }
+        scratch->n = job->n;
+        scratch->diagonals = job->diagonals;
+        scratch->population_capacity = population;
+    }
+
+    return 1;
+}
+
+// Release all scratch memory
+void free_scratch(Scratch *scratch) {
+    arena_destroy(&scratch->arena);
+    memset(scratch, 0, sizeof(Scratch));
+}
+
+// Steepest ascent, with sideways moves or random restarts depending on the algorithm
+Result run_steepest(Scratch *scratch, const Job *job, unsigned long long *rng) {
+    Cube *current = &scratch->current;
+    int sideways = strcmp(job->algorithm, "sideways") == 0;
+    int restart = strcmp(job->algorithm, "restart") == 0;
+    int sideways_moves = 0;
+    Result result = {0, 0, 0};
+    CubeVisited visited = {NULL, 0};
+    unsigned long long hash = 0;
+
+    cube_randomize(current, rng);
+    cube_copy(current, &scratch->best);
+
+    // Sideways moves are a plateau search that never returns to a state of the current plateau,
+    // the visited set holds the states of one plateau (out of memory: plain steepest ascent)
+    if (sideways && cube_visited_init(&visited, job->max_sideways > 0 ? job->max_sideways : 0)) {
+        hash = cube_hash(current);
+        cube_visited_insert(&visited, hash);
+    } else {
+        sideways = 0;
+    }
+
+    while (current->error > 0 && result.iterations < job->budget) {
+        int a = -1, b = -1;
+        long long delta = sideways ? cube_plateau_swap(current, hash, &visited, rng, &a, &b)
+                                   : cube_best_swap(current, rng, &a, &b);
+        result.iterations++;
+
+        if (delta < 0 || (sideways && a >= 0 && sideways_moves < job->max_sideways)) {
+            if (sideways) {
+                hash = cube_swap_hash(current, hash, a, b);
+                if (delta < 0) cube_visited_clear(&visited);
+                cube_visited_insert(&visited, hash);
+            }
+            cube_apply_swap(current, a, b, delta);
+            sideways_moves = delta < 0 ? 0 : sideways_moves + 1;
+        } else if (restart && result.restarts < job->max_restarts) {
+            result.restarts++;
+            cube_randomize(current, rng);
+        } else {
+            break;
+        }
+
+        if (current->error < scratch->best.error) {
+            cube_copy(current, &scratch->best);
+        }
+        publish_job(scratch, job, &result, current->error, scratch->best.error, 0);
+    }
+
+    if (visited.slots != NULL) cube_visited_free(&visited);
+    result.error = scratch->best.error;
+    return result;
+}
+
+// Stochastic hill climbing: accept a random swap only if it improves the error
+Result run_stochastic(Scratch *scratch, const Job *job, unsigned long long *rng) {
+    Cube *current = &scratch->current;
+    int large = current->total > CUBE_FULL_NEIGHBOURHOOD_CELLS;
+    Result result = {0, 0, 0};
+
+    cube_randomize(current, rng);
+    while (current->error > 0 && result.iterations < job->budget) {
+        int a = cube_rand_int(rng, current->total), b = cube_rand_int(rng, current->total);
+
+        // On large cubes a uniform swap almost never helps, aim half of them at violated lines
+        if (large && (result.iterations & 1)) {
+            cube_candidate_swap(current, rng, &a, &b);
+        }
+        long long delta = cube_swap_delta(current, a, b);
+        if (delta < 0) {
+            cube_apply_swap(current, a, b, delta);
+        }
+        result.iterations++;
+        if ((result.iterations & (TELEMETRY_INTERVAL - 1)) == 0) {
+            publish_job(scratch, job, &result, current->error, current->error, 0);
+        }
+    }
+
+    cube_copy(current, &scratch->best);
+    result.error = current->error;
+    return result;
+}
+
+// Simulated annealing with geometric cooling, like Annealing.c
+Result run_annealing(Scratch *scratch, const Job *job, unsigned long long *rng) {
+    Cube *current = &scratch->current;
+    double temperature = job->initial_temperature;
+    Result result = {0, 0, 0};
+
+    cube_randomize(current, rng);
+    cube_copy(current, &scratch->best);
+
+    while (temperature > 0 && current->error > 0 && result.iterations < job->budget) {
+        int a = cube_rand_int(rng, current->total), b = cube_rand_int(rng, current->total);
+        long long delta = cube_swap_delta(current, a, b);
+        if (delta < 0 || exp(-(double)delta / temperature) > cube_rand_double(rng)) {
+            cube_apply_swap(current, a, b, delta);
+            if (current->error < scratch->best.error) {
+                cube_copy(current, &scratch->best);
+            }
+        }
+        temperature *= job->alpha;
+        result.iterations++;
+        if ((result.iterations & (TELEMETRY_INTERVAL - 1)) == 0) {
+            publish_job(scratch, job, &result, current->error, scratch->best.error, temperature);
+        }
+    }
+
+    result.error = scratch->best.error;
+    return result;
+}
+
+// Tournament selection over 5 random individuals, like generate_individual()
+int tournament(Cube population[], int size, unsigned long long *rng) {
+    int best = cube_rand_int(rng, size);
+    for (int i = 1; i < 5; i++) {
+        int competitor = cube_rand_int(rng, size);
+        if (population[competitor].error < population[best].error) {
+            best = competitor;
+        }
+    }
+    return best;
+}
+
+// Genetic algorithm with the same operators and elitism as Genetic.c
+Result run_genetic(Scratch *scratch, const Job *job, unsigned long long *rng) {
+    Cube *population = scratch->population;
+    Cube *new_population = scratch->new_population;
+    int size = job->population;
+    int mutations = (int)(scratch->current.total * job->mutation_rate);
+    Result result = {0, 0, 0};
+
+    for (int i = 0; i < size; i++) {
+        cube_randomize(&population[i], rng);
+    }
+
+    int best = 0;
+    for (int i = 1; i < size; i++) {
+        if (population[i].error < population[best].error) best = i;
+    }
+
+    while (population[best].error > 0 && result.iterations < job->budget) {
+        cube_copy(&population[best], &new_population[0]);
+        cube_copy(&population[best], &new_population[1]);
+
+        // crossover() in Genetic.c keeps every cell of the first parent, then mutation() swaps
+        for (int i = 2; i < size; i++) {
+            Cube *child = &new_population[i];
+            int parent = tournament(population, size, rng);
+            cube_copy(&population[parent], child);
+            for (int m = 0; m < mutations; m++) {
+                int a = cube_rand_int(rng, child->total), b = cube_rand_int(rng, child->total);
+                cube_apply_swap(child, a, b, cube_swap_delta(child, a, b));
+            }
+        }
+
+        // Swap the generations instead of copying them
+        Cube *temp = population;
+        population = new_population;
+        new_population = temp;
+
+        best = 0;
+        for (int i = 1; i < size; i++) {
+            if (population[i].error < population[best].error) best = i;
+        }
+        result.iterations++;
+        publish_job(scratch, job, &result, population[best].error, population[best].error, job->mutation_rate);
+    }
+
+    cube_copy(&population[best], &scratch->best);
+    result.error = population[best].error;
+    return result;
+}
+
+// Stream one compact JSON result line
+void write_result(const Job *job, const Result *result, const Cube *best, double duration, size_t memory) {
+    pthread_mutex_lock(&output_lock);
+    printf("{\"id\": ");
+    print_json_string(job->id);
+    printf(", \"status\": \"ok\", \"algorithm\": \"%s\", \"n\": %d, \"seed\": %llu, "
+           "\"error\": %lld, \"objective\": \"%s\", \"objective_value\": %lld, \"iterations\": %lld, "
+           "\"restarts\": %d, \"time\": %.4f, \"memory\": %zu, \"cube\": [",
+           job->algorithm, job->n, job->seed, cube_deviation(best), objective_name(), result->error,
+           result->iterations, result->restarts, duration, memory);
+    for (int c = 0; c < best->total; c++) {
+        printf(c == 0 ? "%d" : ",%d", best->cells[c]);
+    }
+    printf("]}\n");
+    fflush(stdout);
+    pthread_mutex_unlock(&output_lock);
+}
+
+// Publish the progress of a job in the slot of its worker, the errors are objective values
+void publish_job(const Scratch *scratch, const Job *job, const Result *result, long long current, long long best,
+                 double temperature) {
+    telemetry_publish(telemetry, scratch->worker, job->id, result->iterations, current, best, temperature,
+                      result->restarts);
+}
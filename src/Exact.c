@@ -0,0 +1,604 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define N 3                 // 3: every solution in well under a second, 4: only the first (FIND_ALL 0), about 30 s
+#define TOTAL_NUMBERS (N * N * N)
+#define MAGIC_NUMBER (N * (TOTAL_NUMBERS + 1)) / 2
+#define PLANE_DIAGONALS 0   // 0: none (like Steepest.c without slices), 1: x-y slices (Steepest.c), 2: all slices (Annealing.c)
+#define FIND_ALL 1          // 1: exhaustive count of all solutions, 0: stop at the first solution
+#define NUM_THREADS 4       // Number of worker threads
+#define SPLIT_DEPTH 3       // Depth of the prefixes that are handed out as tasks
+#define MAX_LINES (3 * N * N + 2 + 6 * N)
+#define TELEMETRY 1         // 1: publish nodes and solutions of every worker in shared memory for Watch.c
+#define TELEMETRY_NODES (1 << 22)  // Nodes between two publishes inside a task, a power of two
+
+#include "telemetry.h"
+
+// A task is a prefix of the search tree (values of the first SPLIT_DEPTH cells in order)
+typedef struct {
+    int values[SPLIT_DEPTH];
+} Task;
+
+// Per-worker deque, the owner pops from the bottom and thieves steal from the top
+typedef struct {
+    Task *tasks;
+    int top;
+    int bottom;
+    int capacity;
+    pthread_mutex_t lock;
+} Deque;
+
+// Per-worker search state
+typedef struct {
+    int id;
+    int cube[TOTAL_NUMBERS];
+    int used[TOTAL_NUMBERS + 1];
+    int line_sum[MAX_LINES];
+    int line_count[MAX_LINES];
+    long long nodes;
+    long long solutions;
+} Worker;
+
+// Line structure shared by all workers (read-only after setup)
+int num_lines;
+int line_cells[MAX_LINES][N];
+int cell_lines[TOTAL_NUMBERS][MAX_LINES];
+int cell_num_lines[TOTAL_NUMBERS];
+
+// Constraint-driven assignment order
+int order[TOTAL_NUMBERS];
+int forced_line[TOTAL_NUMBERS];  // Line completed by the cell at this depth, or -1
+
+// Symmetry breaking on the orbit of the first cell
+int in_orbit[TOTAL_NUMBERS];
+int orbit_size;
+
+Deque deques[NUM_THREADS];
+Worker workers[NUM_THREADS];
+Task *task_store = NULL;
+int task_capacity = 0;
+volatile int stop_search = 0;
+int solution_printed = 0;
+int first_solution[TOTAL_NUMBERS];
+pthread_mutex_t solution_lock = PTHREAD_MUTEX_INITIALIZER;
+TelemetrySegment *telemetry;  // One slot per worker, nodes as iterations and solutions as restarts, no error
+
+// Function prototypes
+void build_lines(void);
+void build_order(void);
+void build_symmetries(void);
+int evaluate(int cube[N][N][N]);
+void print_cube(int cube[N][N][N]);
+int line_feasible(Worker *w, int line);
+int closings_consistent(Worker *w, int cell);
+int can_place(Worker *w, int depth, int value);
+void place(Worker *w, int cell, int value);
+void unplace(Worker *w, int cell, int value);
+void search(Worker *w, int depth);
+void collect_tasks(Worker *w, int depth, Task *prefix, int *num_tasks);
+void push_task(Deque *d, Task *task);
+int pop_task(Deque *d, Task *task);
+int steal_task(Deque *d, Task *task);
+void *worker_main(void *arg);
+
+int main() {
+    clock_t start_time = clock();
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    build_lines();
+    build_order();
+    build_symmetries();
+
+    printf("Exact search for N=%d, magic number %d, %d lines, %d threads\n",
+           N, MAGIC_NUMBER, num_lines, NUM_THREADS);
+    printf("Symmetry orbit of the first cell: %d cells (plus complement map)\n", orbit_size);
+
+    // Enumerate the prefixes of the search tree with a sequential worker
+    Worker *splitter = calloc(1, sizeof(Worker));
+    Task prefix;
+    int num_tasks = 0;
+    collect_tasks(splitter, 0, &prefix, &num_tasks);
+    free(splitter);
+
+    // Deal the prefixes round-robin into the per-worker deques
+    for (int t = 0; t < NUM_THREADS; t++) {
+        deques[t].capacity = num_tasks / NUM_THREADS + 1;
+        deques[t].tasks = malloc(sizeof(Task) * deques[t].capacity);
+        deques[t].top = 0;
+        deques[t].bottom = 0;
+        pthread_mutex_init(&deques[t].lock, NULL);
+    }
+    for (int i = 0; i < num_tasks; i++) {
+        push_task(&deques[i % NUM_THREADS], &task_store[i]);
+    }
+    free(task_store);
+    printf("Search tree split into %d tasks at depth %d\n", num_tasks, SPLIT_DEPTH);
+
+    telemetry = TELEMETRY ? telemetry_open("Exact", NUM_THREADS) : NULL;
+    pthread_t threads[NUM_THREADS];
+    for (int t = 0; t < NUM_THREADS; t++) {
+        workers[t].id = t;
+        pthread_create(&threads[t], NULL, worker_main, &workers[t]);
+    }
+
+    long long total_nodes = 0, total_solutions = 0;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        total_nodes += workers[t].nodes;
+        total_solutions += workers[t].solutions;
+        free(deques[t].tasks);
+        pthread_mutex_destroy(&deques[t].lock);
+    }
+    telemetry_close(telemetry);
+
+    if (solution_printed) {
+        int cube[N][N][N];
+        memcpy(cube, first_solution, sizeof(cube));
+        printf("Solution Cube:\n");
+        print_cube(cube);
+        printf("Final Error: %d\n", evaluate(cube));
+    } else {
+        printf("No solution exists for this set of lines.\n");
+    }
+
+    printf("Nodes visited: %lld\n", total_nodes);
+    if (FIND_ALL) {
+        printf("Solutions found (symmetry-reduced): %lld\n", total_solutions);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double duration = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+    double wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+    printf("Program execution time: %.2f seconds (CPU %.2f seconds)\n", wall, duration);
+    return 0;
+}
+
+// Add a line given its first cell and the step between consecutive cells
+void add_line(int i, int j, int k, int di, int dj, int dk) {
+    for (int s = 0; s < N; s++) {
+        int cell = (i + s * di) * N * N + (j + s * dj) * N + (k + s * dk);
+        line_cells[num_lines][s] = cell;
+        cell_lines[cell][cell_num_lines[cell]++] = num_lines;
+    }
+    num_lines++;
+}
+
+// Build the same lines that evaluate() checks
+void build_lines(void) {
+    num_lines = 0;
+
+    // Rows, columns and pillars
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            add_line(i, j, 0, 0, 0, 1);
+        }
+    }
+    for (int j = 0; j < N; j++) {
+        for (int k = 0; k < N; k++) {
+            add_line(0, j, k, 1, 0, 0);
+        }
+    }
+    for (int i = 0; i < N; i++) {
+        for (int k = 0; k < N; k++) {
+            add_line(i, 0, k, 0, 1, 0);
+        }
+    }
+
+    // Main space diagonals
+    add_line(0, 0, 0, 1, 1, 1);
+    add_line(0, 0, N - 1, 1, 1, -1);
+
+    // Diagonals in horizontal (x-y) slices
+    if (PLANE_DIAGONALS >= 1) {
+        for (int i = 0; i < N; i++) {
+            add_line(i, 0, 0, 0, 1, 1);
+            add_line(i, 0, N - 1, 0, 1, -1);
+        }
+    }
+
+    // Diagonals in vertical (y-z) and (x-z) slices
+    if (PLANE_DIAGONALS >= 2) {
+        for (int j = 0; j < N; j++) {
+            add_line(0, j, 0, 1, 0, 1);
+            add_line(N - 1, j, 0, -1, 0, 1);
+        }
+        for (int k = 0; k < N; k++) {
+            add_line(0, 0, k, 1, 1, 0);
+            add_line(0, N - 1, k, 1, -1, 0);
+        }
+    }
+}
+
+// Order the cells so that lines are completed as early as possible
+void build_order(void) {
+    int placed[TOTAL_NUMBERS] = {0};
+    int count[MAX_LINES] = {0};
+
+    for (int depth = 0; depth < TOTAL_NUMBERS; depth++) {
+        int best_cell = -1;
+        long best_score = -1;
+
+        if (depth == 0) {
+            best_cell = 0;  // Corner cell, it anchors the symmetry breaking
+        } else {
+            for (int c = 0; c < TOTAL_NUMBERS; c++) {
+                if (placed[c]) continue;
+
+                // Prefer cells that close lines, then cells on the most filled lines
+                long score = 0;
+                for (int l = 0; l < cell_num_lines[c]; l++) {
+                    int filled = count[cell_lines[c][l]];
+                    score += (filled == N - 1 ? 1000L : 0) + filled * filled * 10 + 1;
+                }
+                if (score > best_score) {
+                    best_score = score;
+                    best_cell = c;
+                }
+            }
+        }
+
+        placed[best_cell] = 1;
+        order[depth] = best_cell;
+        forced_line[depth] = -1;
+        for (int l = 0; l < cell_num_lines[best_cell]; l++) {
+            int line = cell_lines[best_cell][l];
+            if (++count[line] == N) {
+                forced_line[depth] = line;
+            }
+        }
+    }
+}
+
+// Find the cube symmetries that map the set of checked lines onto itself
+void build_symmetries(void) {
+    static const int axes[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+    int permutation[TOTAL_NUMBERS];
+    int line_mask[MAX_LINES][(TOTAL_NUMBERS + 31) / 32];
+
+    memset(line_mask, 0, sizeof(line_mask));
+    for (int l = 0; l < num_lines; l++) {
+        for (int s = 0; s < N; s++) {
+            line_mask[l][line_cells[l][s] / 32] |= 1u << (line_cells[l][s] % 32);
+        }
+    }
+
+    memset(in_orbit, 0, sizeof(in_orbit));
+    for (int a = 0; a < 6; a++) {
+        for (int flips = 0; flips < 8; flips++) {
+            for (int c = 0; c < TOTAL_NUMBERS; c++) {
+                int coord[3] = {c / (N * N), (c / N) % N, c % N};
+                int image[3];
+                for (int d = 0; d < 3; d++) {
+                    image[d] = coord[axes[a][d]];
+                    if (flips & (1 << d)) image[d] = N - 1 - image[d];
+                }
+                permutation[c] = image[0] * N * N + image[1] * N + image[2];
+            }
+
+            // Every line must be mapped onto some line
+            int preserves = 1;
+            for (int l = 0; l < num_lines && preserves; l++) {
+                unsigned mask[(TOTAL_NUMBERS + 31) / 32] = {0};
+                for (int s = 0; s < N; s++) {
+                    int cell = permutation[line_cells[l][s]];
+                    mask[cell / 32] |= 1u << (cell % 32);
+                }
+                int found = 0;
+                for (int m = 0; m < num_lines && !found; m++) {
+                    found = memcmp(mask, line_mask[m], sizeof(mask)) == 0;
+                }
+                preserves = found;
+            }
+
+            if (preserves) {
+                in_orbit[permutation[order[0]]] = 1;
+            }
+        }
+    }
+
+    orbit_size = 0;
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        orbit_size += in_orbit[c];
+    }
+}
+
+// Check that a line can still reach MAGIC_NUMBER with the unused values
+int line_feasible(Worker *w, int line) {
+    int remaining = N - w->line_count[line];
+    int need = MAGIC_NUMBER - w->line_sum[line];
+
+    if (remaining == 0) {
+        return need == 0;
+    }
+    if (remaining == 1) {
+        return need >= 1 && need <= TOTAL_NUMBERS && !w->used[need];
+    }
+    if (remaining == 2) {
+        // Need a pair of distinct unused values adding up to need
+        for (int v = need - TOTAL_NUMBERS > 1 ? need - TOTAL_NUMBERS : 1; 2 * v < need; v++) {
+            if (!w->used[v] && !w->used[need - v]) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Sum of the smallest and largest unused values
+    int low = 0, high = 0;
+    for (int v = 1, taken = 0; v <= TOTAL_NUMBERS && taken < remaining; v++) {
+        if (!w->used[v]) {
+            low += v;
+            taken++;
+        }
+    }
+    if (need < low) {
+        return 0;
+    }
+    for (int v = TOTAL_NUMBERS, taken = 0; v >= 1 && taken < remaining; v--) {
+        if (!w->used[v]) {
+            high += v;
+            taken++;
+        }
+    }
+    return need <= high;
+}
+
+// Lines with one open cell left force its value: two such lines through the same open cell must
+// need the same value, and two lines closing at different cells must need different values.
+// Checked for the lines through the cell just placed and the other lines through their open cells.
+int closings_consistent(Worker *w, int cell) {
+    int open[MAX_LINES], need[MAX_LINES], count = 0;
+
+    for (int l = 0; l < cell_num_lines[cell]; l++) {
+        int line = cell_lines[cell][l];
+        if (w->line_count[line] != N - 1) continue;
+        int s = 0;
+        while (w->cube[line_cells[line][s]] != 0) s++;
+        open[count] = line_cells[line][s];
+        need[count] = MAGIC_NUMBER - w->line_sum[line];
+        for (int i = 0; i < count; i++) {
+            if ((open[i] == open[count]) != (need[i] == need[count])) {
+                return 0;
+            }
+        }
+        for (int m = 0; m < cell_num_lines[open[count]]; m++) {
+            int other = cell_lines[open[count]][m];
+            if (w->line_count[other] == N - 1 && MAGIC_NUMBER - w->line_sum[other] != need[count]) {
+                return 0;
+            }
+        }
+        count++;
+    }
+    return 1;
+}
+
+// Symmetry-breaking constraints on the orbit of the first cell
+int can_place(Worker *w, int depth, int value) {
+    int cell = order[depth];
+
+    if (depth == 0) {
+        // The first cell holds the orbit minimum and min + max <= TOTAL_NUMBERS + 1
+        return 2 * value <= TOTAL_NUMBERS + 1;
+    }
+    if (in_orbit[cell]) {
+        int first = w->cube[order[0]];
+        return value > first && value <= TOTAL_NUMBERS + 1 - first;
+    }
+    return 1;
+}
+
+// Assign a value to a cell and update the line sums
+void place(Worker *w, int cell, int value) {
+    w->cube[cell] = value;
+    w->used[value] = 1;
+    for (int l = 0; l < cell_num_lines[cell]; l++) {
+        int line = cell_lines[cell][l];
+        w->line_sum[line] += value;
+        w->line_count[line]++;
+    }
+}
+
+// Undo an assignment
+void unplace(Worker *w, int cell, int value) {
+    w->cube[cell] = 0;
+    w->used[value] = 0;
+    for (int l = 0; l < cell_num_lines[cell]; l++) {
+        int line = cell_lines[cell][l];
+        w->line_sum[line] -= value;
+        w->line_count[line]--;
+    }
+}
+
+// Try one value at a given depth, returns 1 if the assignment is consistent
+int try_value(Worker *w, int depth, int value) {
+    int cell = order[depth];
+
+    if (w->used[value] || !can_place(w, depth, value)) {
+        return 0;
+    }
+    place(w, cell, value);
+    for (int l = 0; l < cell_num_lines[cell]; l++) {
+        if (!line_feasible(w, cell_lines[cell][l])) {
+            unplace(w, cell, value);
+            return 0;
+        }
+    }
+    if (!closings_consistent(w, cell)) {
+        unplace(w, cell, value);
+        return 0;
+    }
+    return 1;
+}
+
+// Record a complete solution
+void report_solution(Worker *w) {
+    w->solutions++;
+    pthread_mutex_lock(&solution_lock);
+    if (!solution_printed) {
+        memcpy(first_solution, w->cube, sizeof(first_solution));
+        solution_printed = 1;
+    }
+    pthread_mutex_unlock(&solution_lock);
+    if (!FIND_ALL) {
+        stop_search = 1;
+    }
+}
+
+// Depth-first search over the remaining cells
+void search(Worker *w, int depth) {
+    if (stop_search) {
+        return;
+    }
+    if (depth == TOTAL_NUMBERS) {
+        report_solution(w);
+        return;
+    }
+    w->nodes++;
+    if ((w->nodes & (TELEMETRY_NODES - 1)) == 0) {
+        telemetry_publish(telemetry, w->id, "exact", w->nodes, -1, -1, 0, w->solutions);
+    }
+
+    int cell = order[depth];
+
+    // The last cell of a line has its value forced
+    if (forced_line[depth] >= 0) {
+        int value = MAGIC_NUMBER - w->line_sum[forced_line[depth]];
+        if (value >= 1 && value <= TOTAL_NUMBERS && try_value(w, depth, value)) {
+            search(w, depth + 1);
+            unplace(w, cell, value);
+        }
+        return;
+    }
+
+    // Values nearest the mean the lines through the cell still need per open cell go first, every
+    // value is still tried so the count of solutions stays exhaustive
+    int target = 0;
+    for (int l = 0; l < cell_num_lines[cell]; l++) {
+        int line = cell_lines[cell][l];
+        target += (MAGIC_NUMBER - w->line_sum[line]) / (N - w->line_count[line]);
+    }
+    target = cell_num_lines[cell] > 0 ? target / cell_num_lines[cell] : (TOTAL_NUMBERS + 1) / 2;
+    target = target < 1 ? 1 : target > TOTAL_NUMBERS ? TOTAL_NUMBERS : target;
+    for (int step = 0; step < 2 * TOTAL_NUMBERS; step++) {
+        int value = step & 1 ? target + (step + 1) / 2 : target - step / 2;
+        if (value >= 1 && value <= TOTAL_NUMBERS && try_value(w, depth, value)) {
+            search(w, depth + 1);
+            unplace(w, cell, value);
+        }
+    }
+}
+
+// Enumerate the consistent prefixes of length SPLIT_DEPTH
+void collect_tasks(Worker *w, int depth, Task *prefix, int *num_tasks) {
+    if (depth == SPLIT_DEPTH) {
+        if (*num_tasks == task_capacity) {
+            task_capacity = task_capacity ? 2 * task_capacity : 1024;
+            task_store = realloc(task_store, sizeof(Task) * task_capacity);
+        }
+        task_store[(*num_tasks)++] = *prefix;
+        return;
+    }
+
+    int cell = order[depth];
+    for (int value = 1; value <= TOTAL_NUMBERS; value++) {
+        if (forced_line[depth] >= 0 && value != MAGIC_NUMBER - w->line_sum[forced_line[depth]]) {
+            continue;
+        }
+        if (try_value(w, depth, value)) {
+            prefix->values[depth] = value;
+            collect_tasks(w, depth + 1, prefix, num_tasks);
+            unplace(w, cell, value);
+        }
+    }
+}
+
+// Push a task at the bottom of a deque
+void push_task(Deque *d, Task *task) {
+    pthread_mutex_lock(&d->lock);
+    d->tasks[d->bottom++] = *task;
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Pop a task from the bottom of the own deque
+int pop_task(Deque *d, Task *task) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        *task = d->tasks[--d->bottom];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+// Steal a task from the top of another deque
+int steal_task(Deque *d, Task *task) {
+    int found = 0;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        *task = d->tasks[d->top++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+// Worker loop: run own tasks, then steal from the others until all deques are empty
+void *worker_main(void *arg) {
+    Worker *w = (Worker *)arg;
+    Task task;
+
+    while (!stop_search) {
+        int found = pop_task(&deques[w->id], &task);
+        for (int t = 1; t < NUM_THREADS && !found; t++) {
+            found = steal_task(&deques[(w->id + t) % NUM_THREADS], &task);
+        }
+        if (!found) {
+            break;
+        }
+
+        // Replay the prefix, it was already checked when the tasks were collected
+        for (int depth = 0; depth < SPLIT_DEPTH; depth++) {
+            place(w, order[depth], task.values[depth]);
+        }
+        search(w, SPLIT_DEPTH);
+        for (int depth = SPLIT_DEPTH - 1; depth >= 0; depth--) {
+            unplace(w, order[depth], task.values[depth]);
+        }
+        telemetry_publish(telemetry, w->id, "exact", w->nodes, -1, -1, 0, w->solutions);
+    }
+    telemetry_status(telemetry, w->id, TELEMETRY_DONE);
+    return NULL;
+}
+
+// Print the cube
+void print_cube(int cube[N][N][N]) {
+    for (int i = 0; i < N; i++) {
+        printf("Slice %d:\n", i + 1);
+        for (int j = 0; j < N; j++) {
+            for (int k = 0; k < N; k++) {
+                printf("%3d ", cube[i][j][k]);
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+}
+
+// Evaluate the error of the cube over the same lines the search checks
+int evaluate(int cube[N][N][N]) {
+    int *cells = &cube[0][0][0];
+    int error = 0;
+    for (int l = 0; l < num_lines; l++) {
+        int sum = 0;
+        for (int s = 0; s < N; s++) {
+            sum += cells[line_cells[l][s]];
+        }
+        error += abs(sum - MAGIC_NUMBER);
+    }
+    return error;
+}
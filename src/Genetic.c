@@ -3,16 +3,86 @@
 #include <time.h>
 #include <omp.h>
 #include <math.h>
+#include <limits.h>
 
 #define N 5                                         // Size of the cube
 #define TOTAL_NUMBERS (N * N * N)                   // Total number of cubes
 #define MAGIC_NUMBER (N * (TOTAL_NUMBERS + 1)) / 2  // Magic number of cubes
+#define CANONICAL_PLANE_DIAGONALS 2                 // evaluate() checks the diagonals of every slice
+#define ARCHIVE 1                                   // 1: store the final cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes.arc"                    // Archive of final cubes shared by all solvers
+#define WARM_START 0                                // 1: seed the population with the best archived cubes
+#define WARM_START_TOP_K 10                         // Number of archived cubes to seed the population with
+#define SELECTION_TOURNAMENT 0                      // Best of TOURNAMENT_SIZE random individuals
+#define SELECTION_RANK 1                            // Linear rank weights, drawn by prefix-sum binary search
+#define SELECTION_SUS 2                             // Stochastic universal sampling over fitness weights
+#define SELECTION SELECTION_TOURNAMENT              // Parent selection operator
+#define TOURNAMENT_SIZE 5                           // Individuals competing in one tournament
+#define ELITE_COUNT 2                               // Best individuals copied unchanged to the next generation
+#define MUTATION_RATE 0.05                          // Fraction of the cells touched by mutation per child
+#define ADAPTIVE_MUTATION 0                         // 1: raise the rate while the best fitness stagnates
+#define MAX_MUTATION_RATE 0.3                       // Upper bound of the adaptive mutation rate
+#define STAGNATION_GENERATIONS 10                   // Generations without a new best before the rate grows
+#define SCRAMBLE_PROBABILITY 0.0                    // Chance that a mutation shuffles one whole line
+#define INVERSION_PROBABILITY 0.0                   // Chance that a mutation reverses one whole line
+#define CROSSOVER_CLONE 0                           // Child is a copy of parent1, only mutation changes it
+#define CROSSOVER_SLICE 1                           // Inherit the slices of parent2 whose lines are better
+#define CROSSOVER_LINES 2                           // Inherit the satisfied lines of both parents
+#define CROSSOVER CROSSOVER_LINES                   // Crossover operator
+#define REPAIR_PASSES 2                             // Passes of best-swap repair over the displaced cells
+#define NUM_LINES (3 * N * N + 2 + 6 * N)           // Lines checked by evaluate()
+#define LINES_PER_CELL 13                           // Upper bound of the lines through one cell
+#define MAX_THREADS 256                             // Random number streams, one per OpenMP thread
+#define MEMORY_PAGES ARENA_PAGES_TRANSPARENT        // Page kind backing the population arena
+#define MEMORY_LIMIT (1UL << 30)                    // Cap on the population and selection memory
+#ifndef ISLAND_MODEL
+#define ISLAND_MODEL 0                              // 1: one population per process, trading migrants (transport.h)
+#endif
+#define ISLANDS 4                                   // Processes of the local transport, mpirun sets it with MPI
+#define MIGRATION_INTERVAL 10                       // Generations between two migrations
+#define MIGRANTS 2                                  // Best individuals sent to the next island of the ring
+#define MESSAGE_MIGRANT 0                           // Individual for the population of the receiver
+#define MESSAGE_BEST 1                              // Best individual of the sender so far
+#define MESSAGE_FINAL 2                             // Best individual of an island that has finished
+#define CELL_BYTES (TOTAL_NUMBERS > 255 ? 2 : 1)    // Bytes per cell in a message
+#define MESSAGE_HEADER 12                           // Type, N, source, fitness and generation
+#define MESSAGE_SIZE (MESSAGE_HEADER + TOTAL_NUMBERS * CELL_BYTES)
+#define TELEMETRY 1                                 // 1: publish progress in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 1                        // Generations between two publishes
+
+#include "archive.h"
+#include "objective.h"
+#include "arena.h"
+#include "trace.h"
+#include "transport.h"
+#include "telemetry.h"
 
 typedef struct {
     int cube[N][N][N];  // The N x N x N cube
     int fitness;        // Fitness score
+    int line_sum[NUM_LINES];  // Sum of every line, kept up to date for incremental mutation
 } Individual;
 
+// Lines through every cell and cells of every line, built once by init_lines()
+int cell_lines[TOTAL_NUMBERS][LINES_PER_CELL];
+int cell_num_lines[TOTAL_NUMBERS];
+int line_cells[NUM_LINES][N];
+int cell_slice[TOTAL_NUMBERS][3];   // Slice index of a cell along the i, j and k axes
+int line_slice[NUM_LINES][3];       // Slice a line lies in along each axis, -1 if it crosses slices
+
+// Per-thread random streams for selection and mutation, four xorshift lanes each
+unsigned long long mutation_rng[MAX_THREADS][4];
+
+// Island model: the transport, the best individual this island broadcast last, and on island 0
+// the final report of every island
+Transport transport;
+int best_sent = -1;
+int solution_found = 0;                             // Some island reached fitness 0, all of them stop
+Individual island_best;
+int island_generations[TRANSPORT_MAX_PROCESSES];
+int island_fitness[TRANSPORT_MAX_PROCESSES];
+int islands_finished = 0;
+
 // Swap two integers
 void swap(int *a, int *b) {
     int temp = *a;
@@ -44,8 +114,8 @@ void initialize_cube(int cube[N][N][N]) {
     }
 }
 
-// Evaluate objective function
-int evaluate(int cube[N][N][N]) {
+// Score the lines of the cube with the objective, or by |sum - MAGIC_NUMBER| when absolute is set
+int score_cube(int cube[N][N][N], int absolute) {
     int error = 0;
     int sum;
 
@@ -56,7 +126,7 @@ int evaluate(int cube[N][N][N]) {
             for (int k = 0; k < N; k++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -67,7 +137,7 @@ int evaluate(int cube[N][N][N]) {
             for (int i = 0; i < N; i++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -78,7 +148,7 @@ int evaluate(int cube[N][N][N]) {
             for (int j = 0; j < N; j++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -87,13 +157,13 @@ int evaluate(int cube[N][N][N]) {
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][i];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     sum = 0;
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][N - i - 1];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     // Evaluate diagonal in slices
 // Evaluate diagonals in horizontal (x-y) slices
@@ -102,13 +172,13 @@ int evaluate(int cube[N][N][N]) {
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][j];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][N - j - 1];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     // Evaluate diagonals in vertical (y-z) slices
@@ -117,13 +187,13 @@ int evaluate(int cube[N][N][N]) {
         for (int k = 0; k < N; k++) {
             sum += cube[k][j][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int k = 0; k < N; k++) {
             sum += cube[N - k - 1][j][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     // Evaluate diagonals in vertical (x-z) slices
@@ -132,39 +202,200 @@ int evaluate(int cube[N][N][N]) {
         for (int i = 0; i < N; i++) {
             sum += cube[i][i][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int i = 0; i < N; i++) {
             sum += cube[i][N - i - 1][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     return error;
 }
 
+// Objective of the cube, the score the search minimises
+int evaluate(int cube[N][N][N]) {
+    return score_cube(cube, 0);
+}
+
+// Sum of absolute line deviations, the error that is printed and archived
+int deviation(int cube[N][N][N]) {
+    return score_cube(cube, 1);
+}
+
+// Add a line given its first cell and the step between consecutive cells
+void add_line(int *num_lines, int i, int j, int k, int di, int dj, int dk) {
+    for (int s = 0; s < N; s++) {
+        int cell = (i + s * di) * N * N + (j + s * dj) * N + (k + s * dk);
+        line_cells[*num_lines][s] = cell;
+        cell_lines[cell][cell_num_lines[cell]++] = *num_lines;
+    }
+    (*num_lines)++;
+}
+
+// Build the line tables in the same order as evaluate() and seed the mutation streams
+void init_lines(unsigned int seed) {
+    int num_lines = 0;
+    for (int i = 0; i < N; i++) for (int j = 0; j < N; j++) add_line(&num_lines, i, j, 0, 0, 0, 1);
+    for (int j = 0; j < N; j++) for (int k = 0; k < N; k++) add_line(&num_lines, 0, j, k, 1, 0, 0);
+    for (int i = 0; i < N; i++) for (int k = 0; k < N; k++) add_line(&num_lines, i, 0, k, 0, 1, 0);
+    add_line(&num_lines, 0, 0, 0, 1, 1, 1);
+    add_line(&num_lines, 0, 0, N - 1, 1, 1, -1);
+    for (int i = 0; i < N; i++) {
+        add_line(&num_lines, i, 0, 0, 0, 1, 1);
+        add_line(&num_lines, i, 0, N - 1, 0, 1, -1);
+    }
+    for (int j = 0; j < N; j++) {
+        add_line(&num_lines, 0, j, 0, 1, 0, 1);
+        add_line(&num_lines, N - 1, j, 0, -1, 0, 1);
+    }
+    for (int k = 0; k < N; k++) {
+        add_line(&num_lines, 0, 0, k, 1, 1, 0);
+        add_line(&num_lines, 0, N - 1, k, 1, -1, 0);
+    }
+
+    // Slices of cells and lines, used by slice crossover
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        cell_slice[c][0] = c / (N * N);
+        cell_slice[c][1] = c / N % N;
+        cell_slice[c][2] = c % N;
+    }
+    for (int l = 0; l < NUM_LINES; l++) {
+        for (int axis = 0; axis < 3; axis++) {
+            line_slice[l][axis] = cell_slice[line_cells[l][0]][axis];
+            for (int s = 1; s < N; s++) {
+                if (cell_slice[line_cells[l][s]][axis] != line_slice[l][axis]) line_slice[l][axis] = -1;
+            }
+        }
+    }
+
+    for (int t = 0; t < MAX_THREADS; t++) {
+        for (int lane = 0; lane < 4; lane++) {
+            mutation_rng[t][lane] = (seed + 1ULL) * 0x9E3779B97F4A7C15ULL + (t * 4ULL + lane + 1) * 0xBF58476D1CE4E5B9ULL;
+        }
+    }
+}
+
+// Evaluate an individual and remember its line sums
+void evaluate_individual(Individual *individual) {
+    const int *cells = &individual->cube[0][0][0];
+    individual->fitness = 0;
+    for (int l = 0; l < NUM_LINES; l++) {
+        int sum = 0;
+        for (int s = 0; s < N; s++) {
+            sum += cells[line_cells[l][s]];
+        }
+        individual->line_sum[l] = sum;
+        individual->fitness += objective_cost(sum - MAGIC_NUMBER, objective_line_class(l, N));
+    }
+}
+
+// Swap two cells and update the line sums and fitness through the affected lines only
+void swap_cells(Individual *individual, int a, int b) {
+    int *cells = &individual->cube[0][0][0];
+    int diff = cells[b] - cells[a];
+
+    if (diff == 0) {
+        return;
+    }
+    for (int l = 0; l < cell_num_lines[a]; l++) {
+        int line = cell_lines[a][l];
+        int sum = individual->line_sum[line];
+        individual->fitness += objective_line_delta(sum - MAGIC_NUMBER, diff, objective_line_class(line, N));
+        individual->line_sum[line] = sum + diff;
+    }
+    for (int l = 0; l < cell_num_lines[b]; l++) {
+        int line = cell_lines[b][l];
+        int sum = individual->line_sum[line];
+        individual->fitness += objective_line_delta(sum - MAGIC_NUMBER, -diff, objective_line_class(line, N));
+        individual->line_sum[line] = sum - diff;
+    }
+    swap(&cells[a], &cells[b]);
+}
+
+// Fill out[] with random numbers in [0, bound), four independent lanes so the loop vectorises
+void fill_random(unsigned long long lanes[4], int out[], int count, int bound) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            unsigned long long x = lanes[lane];
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+            lanes[lane] = x;
+            out[i + lane] = (int)(((x * 2685821657736338717ULL) >> 32) * (unsigned long long)bound >> 32);
+        }
+    }
+    for (; i < count; i++) {
+        unsigned long long x = lanes[0];
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        lanes[0] = x;
+        out[i] = (int)(((x * 2685821657736338717ULL) >> 32) * (unsigned long long)bound >> 32);
+    }
+}
+
+// Uniform random number in [0, 1) from the first lane of a stream
+double random_unit(unsigned long long lanes[4]) {
+    unsigned long long x = lanes[0];
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    lanes[0] = x;
+    return ((x * 2685821657736338717ULL) >> 11) * 0x1.0p-53;
+}
+
+// Uniform random number in [0, bound) from the first lane of a stream, multiply-shift has no modulo bias
+int random_below(unsigned long long lanes[4], int bound) {
+    unsigned long long x = lanes[0];
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    lanes[0] = x;
+    return (int)(((x * 2685821657736338717ULL) >> 32) * (unsigned long long)bound >> 32);
+}
+
 // Generate a population with random individuals
 void generate_population(Individual population[], int population_size) {
 
     // Loop to initialize the population
     for (int i = 0; i < population_size; i++) {
         initialize_cube(population[i].cube);
-        population[i].fitness = evaluate(population[i].cube);
+        evaluate_individual(&population[i]);
     }
 }
 
-// Generate individual
+// Replace the first individuals with the best archived cubes
+void seed_population(Individual population[], int population_size) {
+    Archive archive;
+    long long best[WARM_START_TOP_K];
+
+    if (archive_open(&archive, ARCHIVE_FILE)) {
+        int found = archive_top_k(&archive, best, WARM_START_TOP_K);
+        for (int i = 0; i < found && i < population_size; i++) {
+            archive_load(&archive, best[i], population[i].cube);
+            evaluate_individual(&population[i]);
+        }
+    }
+    archive_close(&archive);
+}
+
+// Generate individual, called from the breeding loop so it draws from the thread's own stream
 int generate_individual(Individual population[], int population_size) {
+    unsigned long long *lanes = mutation_rng[omp_get_thread_num() % MAX_THREADS];
+    int draws[TOURNAMENT_SIZE];
+    fill_random(lanes, draws, TOURNAMENT_SIZE, population_size);
 
     // Initialize best individual by generating random individual from population
-    int best_individual = rand() % population_size;
+    int best_individual = draws[0];
 
     // Loop to find best individual
-    for (int i = 1; i < 5; i++) {
+    for (int i = 1; i < TOURNAMENT_SIZE; i++) {
 
         // Initialize competitor individiual by generating another random individual from population
-        int competitor_individual = rand() % population_size;
+        int competitor_individual = draws[i];
 
         // Check if competitor individual's fitness is less than the best individual's fitness
         if (population[competitor_individual].fitness < population[best_individual].fitness) {
@@ -174,189 +405,650 @@ int generate_individual(Individual population[], int population_size) {
     return best_individual;
 }
 
-// Do a crossover 
-void crossover(Individual *parent1, Individual *parent2, Individual *child) {
-    int map[N * N * N] = {0};  
-    int idx = 0;
+// Compare two individuals by fitness, for sorting (index, fitness) pairs
+int compare_fitness(const void *a, const void *b) {
+    const int *x = (const int *)a, *y = (const int *)b;
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
 
-    // Initialize child's value with -1
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
-                child->cube[i][j][k] = -1;
-            }
+// Build the cumulative weights used by rank and SUS selection, order[] maps slots to individuals
+void build_selection_table(Individual population[], int population_size, double prefix[], int order[]) {
+    double total = 0;
+
+    if (SELECTION == SELECTION_RANK) {
+
+        // Sort by fitness, the best individual gets weight population_size and the worst 1
+        int (*pairs)[2] = malloc(sizeof(int[2]) * population_size);
+        for (int i = 0; i < population_size; i++) {
+            pairs[i][0] = i;
+            pairs[i][1] = population[i].fitness;
+        }
+        qsort(pairs, population_size, sizeof(int[2]), compare_fitness);
+        for (int r = 0; r < population_size; r++) {
+            order[r] = pairs[r][0];
+            total += population_size - r;
+            prefix[r] = total;
+        }
+        free(pairs);
+    } else {
+
+        // Fitness is an error, so the weight is how much better than the worst an individual is
+        int worst = population[0].fitness;
+        for (int i = 1; i < population_size; i++) {
+            if (population[i].fitness > worst) worst = population[i].fitness;
+        }
+        for (int i = 0; i < population_size; i++) {
+            order[i] = i;
+            total += worst - population[i].fitness + 1;
+            prefix[i] = total;
         }
     }
+}
 
-    // Copy a cycle of values from parent1
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
+// Draw one individual by binary search on the cumulative weights
+int sample_individual(double prefix[], int order[], int population_size, double u) {
+    double target = u * prefix[population_size - 1];
+    int low = 0, high = population_size - 1;
+
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (prefix[mid] <= target) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return order[low];
+}
 
-                // If a child's value is -1
-                if (child->cube[i][j][k] == -1) {
+// Draw count parents at once with evenly spaced pointers (stochastic universal sampling)
+void sus_parents(double prefix[], int order[], int population_size, int parents[], int count) {
+    double step = prefix[population_size - 1] / count;
+    double pointer = step * ((double)rand() / ((double)RAND_MAX + 1));
+    int slot = 0;
 
-                    // Store parent1 & child value in a temporary variable
-                    int temp = parent1->cube[i][j][k];
-                    child->cube[i][j][k] = temp;
-                    map[temp - 1] = 1;  
-                }
-            }
+    // One pass over the prefix sums serves every pointer, O(1) amortised per parent
+    for (int p = 0; p < count; p++) {
+        while (slot < population_size - 1 && prefix[slot] <= pointer) {
+            slot++;
         }
+        parents[p] = order[slot];
+        pointer += step;
     }
 
-    // Fill the rest from parent2 without duplicates
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
+    // Shuffle so consecutive parents are not always neighbours in the table
+    for (int p = count - 1; p > 0; p--) {
+        swap(&parents[p], &parents[rand() % (p + 1)]);
+    }
+}
 
-                // If child's value is -1
-                if (child->cube[i][j][k] == -1) {
+// Error change if cells a and b were swapped, both line lists are sorted so shared lines are skipped
+int swap_delta(Individual *individual, int a, int b) {
+    const int *cells = &individual->cube[0][0][0];
+    int diff = cells[b] - cells[a];
+    int delta = 0, la = 0, lb = 0;
+
+    while (la < cell_num_lines[a] || lb < cell_num_lines[b]) {
+        int line, change;
+        if (lb >= cell_num_lines[b] || (la < cell_num_lines[a] && cell_lines[a][la] < cell_lines[b][lb])) {
+            line = cell_lines[a][la++];
+            change = diff;
+        } else if (la >= cell_num_lines[a] || cell_lines[b][lb] < cell_lines[a][la]) {
+            line = cell_lines[b][lb++];
+            change = -diff;
+        } else {
+            la++;
+            lb++;
+            continue;
+        }
+        int sum = individual->line_sum[line];
+        delta += objective_line_delta(sum - MAGIC_NUMBER, change, objective_line_class(line, N));
+    }
+    return delta;
+}
 
-                    // Store parent2's value in a temporary variable
-                    int temp = parent2->cube[i][j][k];
+// Give cell c the value v by swapping it in from wherever it is, returns 0 if that cell is locked
+int place_value(Individual *child, int position[], unsigned char locked[], int c, int v) {
+    int *cells = &child->cube[0][0][0];
+    int p = position[v];
 
+    if (p != c) {
+        if (locked[p]) {
+            return 0;
+        }
+        position[cells[c]] = p;
+        position[v] = c;
+        swap_cells(child, c, p);
+    }
+    locked[c] = 1;
+    return 1;
+}
 
-                    if (!map[temp - 1]) {
-                        child->cube[i][j][k] = temp;
-                        map[temp - 1] = 1;
-                    } else {
+// Error of the lines lying inside every slice along an axis, one value per slice
+void slice_errors(Individual *individual, int axis, int errors[N]) {
+    for (int s = 0; s < N; s++) {
+        errors[s] = 0;
+    }
+    for (int l = 0; l < NUM_LINES; l++) {
+        if (line_slice[l][axis] >= 0) {
+            errors[line_slice[l][axis]] += objective_cost(individual->line_sum[l] - MAGIC_NUMBER, objective_line_class(l, N));
+        }
+    }
+}
 
-                        // Find unused value and insert to the array
-                        for (int m = 0; m < N * N * N; m++) {
-                            if (!map[m]) {
-                                child->cube[i][j][k] = m + 1;
-                                map[m] = 1;
-                                break;
-                            }
-                        }
-                    }
-                }
+// Do a crossover: the child starts as parent1, inherits slices or satisfied lines of parent2 by
+// swapping their values into place, then the displaced cells are repaired with the best swaps.
+// Every step goes through swap_cells(), so the fitness is kept up to date without evaluate().
+void crossover(Individual *parent1, Individual *parent2, Individual *child) {
+    unsigned long long *lanes = mutation_rng[omp_get_thread_num() % MAX_THREADS];
+    const int *cells2 = &parent2->cube[0][0][0];
+    int position[TOTAL_NUMBERS + 1];
+    unsigned char locked[TOTAL_NUMBERS] = {0};
+    int draws[2];
+
+    *child = *parent1;
+    if (CROSSOVER == CROSSOVER_CLONE) {
+        return;
+    }
+    int *cells = &child->cube[0][0][0];
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        position[cells[c]] = c;
+    }
+    fill_random(lanes, draws, 2, N);
+
+    if (CROSSOVER == CROSSOVER_SLICE) {
+
+        // Along a random axis, take every slice in which parent2's own lines are better
+        int axis = draws[0] % 3, taken = 0;
+        int errors1[N], errors2[N], take[N];
+        slice_errors(parent1, axis, errors1);
+        slice_errors(parent2, axis, errors2);
+        for (int s = 0; s < N; s++) {
+            taken += take[s] = errors2[s] < errors1[s];
+        }
+        if (taken == 0) {
+            take[draws[1]] = 1;  // Always inherit at least one random slice
+        }
+        for (int c = 0; c < TOTAL_NUMBERS; c++) {
+            if (take[cell_slice[c][axis]]) {
+                place_value(child, position, locked, c, cells2[c]);
+            }
+        }
+    } else {
+
+        // Keep the satisfied lines of parent1, then add those of parent2 that do not clash
+        for (int l = 0; l < NUM_LINES; l++) {
+            if (parent1->line_sum[l] == MAGIC_NUMBER) {
+                for (int s = 0; s < N; s++) locked[line_cells[l][s]] = 1;
+            }
+        }
+        for (int l = 0; l < NUM_LINES; l++) {
+            if (parent2->line_sum[l] != MAGIC_NUMBER) {
+                continue;
+            }
+            int free_line = 1;
+            for (int s = 0; s < N && free_line; s++) {
+                int c = line_cells[l][s];
+                free_line = (!locked[c] || cells[c] == cells2[c]) && (!locked[position[cells2[c]]] || position[cells2[c]] == c);
+            }
+            for (int s = 0; s < N && free_line; s++) {
+                place_value(child, position, locked, line_cells[l][s], cells2[line_cells[l][s]]);
             }
         }
     }
 
-    // Evaluate child's fitness
-    child->fitness = evaluate(child->cube);
+    // Repair: every displaced cell takes the best swap with another displaced cell
+    int displaced[TOTAL_NUMBERS], count = 0;
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        if (!locked[c] && cells[c] != (&parent1->cube[0][0][0])[c]) {
+            displaced[count++] = c;
+        }
+    }
+    for (int pass = 0; pass < REPAIR_PASSES; pass++) {
+        for (int i = 0; i < count; i++) {
+            int best = -1, best_delta = 0;
+            for (int j = 0; j < count; j++) {
+                int delta = swap_delta(child, displaced[i], displaced[j]);
+                if (delta < best_delta) {
+                    best_delta = delta;
+                    best = displaced[j];
+                }
+            }
+            if (best >= 0) {
+                swap_cells(child, displaced[i], best);
+            }
+        }
+    }
 }
 
-// Do a mutation
-void mutation(Individual *individual) {
+// Do a mutation with pre-drawn random cells, updating the fitness swap by swap
+void mutation(Individual *individual, double mutation_rate) {
+    unsigned long long *lanes = mutation_rng[omp_get_thread_num() % MAX_THREADS];
 
-    // Initialize the mutation rate & total mutation
-    double initial_mutation_rate = 0.05;
-    int total_mutation = N * N * N * initial_mutation_rate;
+    // Initialize the total mutation and draw the cells of every swap of this child in one batch
+    int total_mutation = TOTAL_NUMBERS * mutation_rate;
+    int draws[2 * TOTAL_NUMBERS + 4];
+    fill_random(lanes, draws, 2 * total_mutation, TOTAL_NUMBERS);
 
     // Loop to do a mutation
     for (int m = 0; m < total_mutation; m++) {
+        int a = draws[2 * m], b = draws[2 * m + 1];
+        double move = SCRAMBLE_PROBABILITY + INVERSION_PROBABILITY > 0 ? random_unit(lanes) : 1.0;
+
+        if (move < SCRAMBLE_PROBABILITY + INVERSION_PROBABILITY) {
+            // Line moves act on one of the lines through the first drawn cell
+            int line = cell_lines[a][random_below(lanes, cell_num_lines[a])];
+            if (move < SCRAMBLE_PROBABILITY) {
+                for (int s = N - 1; s > 0; s--) {
+                    swap_cells(individual, line_cells[line][s], line_cells[line][random_below(lanes, s + 1)]);
+                }
+            } else {
+                for (int s = 0; s < N / 2; s++) {
+                    swap_cells(individual, line_cells[line][s], line_cells[line][N - 1 - s]);
+                }
+            }
+        } else {
+            // Swapping two cells
+            swap_cells(individual, a, b);
+        }
+    }
+}
+
+// Find the elite_count best individuals, best first, with one partial-selection pass
+void select_elites(Individual population[], int population_size, int elites[], int elite_count) {
+    int found = 0;
+
+    // Keep a small sorted array of the best so far, most individuals are rejected by one comparison
+    for (int i = 0; i < population_size; i++) {
+        int fitness = population[i].fitness;
+        if (found == elite_count && fitness >= population[elites[elite_count - 1]].fitness) {
+            continue;
+        }
+        int pos = found < elite_count ? found++ : elite_count - 1;
+        while (pos > 0 && population[elites[pos - 1]].fitness > fitness) {
+            elites[pos] = elites[pos - 1];
+            pos--;
+        }
+        elites[pos] = i;
+    }
+}
+
+// Pack an individual into a message: a 12-byte little-endian header, then one or two bytes per cell
+void pack_message(unsigned char message[], int type, int generation, const Individual *individual) {
+    const int *cells = &individual->cube[0][0][0];
+    unsigned int header[3] = {(unsigned int)individual->fitness, (unsigned int)generation, 0};
+
+    message[0] = (unsigned char)type;
+    message[1] = N;
+    message[2] = (unsigned char)(transport.rank & 0xFF);
+    message[3] = (unsigned char)(transport.rank >> 8);
+    for (int f = 0; f < 2; f++) {
+        for (int b = 0; b < 4; b++) {
+            message[4 + 4 * f + b] = (unsigned char)(header[f] >> (8 * b));
+        }
+    }
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        for (int b = 0; b < CELL_BYTES; b++) {
+            message[MESSAGE_HEADER + c * CELL_BYTES + b] = (unsigned char)(cells[c] >> (8 * b));
+        }
+    }
+}
+
+// Unpack a message, returns 0 unless it holds a permutation of 1..N^3. The fitness and line
+// sums are computed again rather than trusted
+int unpack_message(const unsigned char message[], int length, int *type, int *source, int *generation,
+                   Individual *individual) {
+    int *cells = &individual->cube[0][0][0];
+    unsigned char seen[TOTAL_NUMBERS + 1] = {0};
 
-        // Randomize the child
-        int i1 = rand() % N, j1 = rand() % N, k1 = rand() % N;
-        int i2 = rand() % N, j2 = rand() % N, k2 = rand() % N;
+    if (length != MESSAGE_SIZE || message[1] != N || message[0] > MESSAGE_FINAL) {
+        return 0;
+    }
+    *type = message[0];
+    *source = message[2] | message[3] << 8;
+    *generation = (int)(message[8] | message[9] << 8 | message[10] << 16 | (unsigned int)message[11] << 24);
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        int value = 0;
+        for (int b = 0; b < CELL_BYTES; b++) {
+            value |= message[MESSAGE_HEADER + c * CELL_BYTES + b] << (8 * b);
+        }
+        if (value < 1 || value > TOTAL_NUMBERS || seen[value]) {
+            return 0;
+        }
+        seen[value] = 1;
+        cells[c] = value;
+    }
+    evaluate_individual(individual);
+    return 1;
+}
 
-        // Swapping two individuals
-        int temp = individual->cube[i1][j1][k1];
-        individual->cube[i1][j1][k1] = individual->cube[i2][j2][k2];
-        individual->cube[i2][j2][k2] = temp;
+// Take in every message that has arrived without waiting. A migrant replaces the worst
+// individual if it is better; the best individuals of other islands only tell when the search is
+// over, so the islands stay diverse; final reports are kept on island 0. Returns the migrants taken in
+int receive_migrants(Individual population[], int population_size) {
+    unsigned char message[MESSAGE_SIZE];
+    Individual migrant;
+    int length, type, source, generation, taken = 0;
+
+    while ((length = transport_receive(&transport, message, sizeof(message))) > 0) {
+        if (!unpack_message(message, length, &type, &source, &generation, &migrant)) {
+            continue;
+        }
+        if (migrant.fitness == 0) {
+            solution_found = 1;
+        }
+        if (type == MESSAGE_FINAL && source < TRANSPORT_MAX_PROCESSES) {
+            island_generations[source] = generation;
+            island_fitness[source] = migrant.fitness;
+            if (islands_finished++ == 0 || migrant.fitness < island_best.fitness) {
+                island_best = migrant;
+            }
+        } else if (type == MESSAGE_MIGRANT && population != NULL) {
+            int worst = 0;
+            for (int i = 1; i < population_size; i++) {
+                if (population[i].fitness > population[worst].fitness) worst = i;
+            }
+            if (migrant.fitness < population[worst].fitness) {
+                population[worst] = migrant;
+                taken++;
+            }
+        }
     }
+    return taken;
+}
 
-    // Evaluate an individual's fitness
-    individual->fitness = evaluate(individual->cube);
+// Send a message that must arrive, taking in what arrives meanwhile so that two islands
+// resending to each other never wait forever. Gives up if the destination has exited
+void send_reliably(int destination, const unsigned char message[]) {
+    struct timespec pause = {0, 1000000};
+    while (transport_send(&transport, destination, message, MESSAGE_SIZE) == 0) {
+        receive_migrants(NULL, 0);
+        nanosleep(&pause, NULL);
+    }
 }
 
-// Find the best individual in the population
-int find_best_individual(Individual population[], int population_size) {
+// Send the MIGRANTS best individuals to the next island of the ring, and the best one to every
+// island when it improved since the last broadcast. Nothing waits for the receivers
+void migrate(Individual population[], int population_size, int generation) {
+    unsigned char message[MESSAGE_SIZE];
+    int migrants[MIGRANTS];
+    int count = population_size < MIGRANTS ? population_size : MIGRANTS;
 
-    // Best individual initialization
-    int best_individual = 0;
+    if (transport.size < 2) {
+        return;
+    }
+    select_elites(population, population_size, migrants, count);
+    for (int m = 0; m < count; m++) {
+        pack_message(message, MESSAGE_MIGRANT, generation, &population[migrants[m]]);
+        transport_send(&transport, (transport.rank + 1) % transport.size, message, MESSAGE_SIZE);
+    }
 
-    // Loop to find the best individual
-    for (int i = 1; i < population_size; i++) {
-        if (population[i].fitness < population[best_individual].fitness) {
-            best_individual = i;
+    const Individual *best = &population[migrants[0]];
+    if (best_sent < 0 || best->fitness < best_sent) {
+        best_sent = best->fitness;
+        pack_message(message, MESSAGE_BEST, generation, best);
+        for (int r = 0; r < transport.size; r++) {
+            if (r == transport.rank) continue;
+            if (best->fitness == 0) {
+                send_reliably(r, message);  // Every island has to hear that the search is over
+            } else {
+                transport_send(&transport, r, message, MESSAGE_SIZE);
+            }
         }
     }
-    return best_individual;
+}
+
+// Report the best individual of this island to island 0, which waits for every report and
+// keeps the overall best in *best
+void finish_island(Individual *best, int generations) {
+    unsigned char message[MESSAGE_SIZE];
+    struct timespec pause = {0, 1000000};
+
+    if (transport.rank != 0) {
+        pack_message(message, MESSAGE_FINAL, generations, best);
+        send_reliably(0, message);
+        return;
+    }
+    island_generations[0] = generations;
+    island_fitness[0] = best->fitness;
+    while (islands_finished < transport.size - 1) {
+        if (receive_migrants(NULL, 0) == 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    if (islands_finished > 0 && island_best.fitness < best->fitness) {
+        *best = island_best;
+    }
 }
 
 // Main function
-int main() {
-    srand(time(NULL));  // Seed the random number generator with the current time
+int main(int argc, char *argv[]) {
+    // Island model: start the other islands first, they run everything below with their own rank
+    if (ISLAND_MODEL && !transport_init(&transport, &argc, &argv, ISLANDS)) {
+        printf("Could not start the islands!\n");
+        exit(1);
+    }
+    int leader = transport.rank == 0;  // Island 0 prints and stores the results
+
+    unsigned int seed = (unsigned int)time(NULL) + transport.rank * 1000003U;
+    srand(seed);  // Seed the random number generator with the current time, different on every island
 
     int iterations = 100;       // Set number of iterations
     int population_size = 100;  // Set population size
     int cube[N][N][N];          // Initialize the 5x5x5 cube
 
-    // Initialize 2 individuals with different population
-    Individual population[population_size];
-    Individual new_population[population_size];
+    // Initialize 2 individuals with different population, from one arena so large populations fit
+    Arena arena;
+    Individual *population = NULL, *new_population = NULL;
+    if (arena_create(&arena, MEMORY_LIMIT, MEMORY_PAGES)) {
+        population = arena_alloc(&arena, sizeof(Individual) * population_size);
+        new_population = arena_alloc(&arena, sizeof(Individual) * population_size);
+    }
+    double *prefix = arena_alloc(&arena, sizeof(double) * population_size);
+    int *order = arena_alloc(&arena, sizeof(int) * population_size);
+    int *parents = arena_alloc(&arena, sizeof(int) * 2 * population_size);
+    if (population == NULL || new_population == NULL || prefix == NULL || order == NULL || parents == NULL) {
+        printf("Not enough memory for the population!\n");
+        exit(1);
+    }
+
+    // Every page goes to the thread that breeds the individual at its start, found with the same
+    // static schedule as the breeding loop, so it sits on that thread's NUMA node
+    int *owner = arena_alloc(&arena, sizeof(int) * population_size);
+    if (owner == NULL) {
+        printf("Not enough memory for the population!\n");
+        exit(1);
+    }
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for (int i = 0; i < population_size; i++) {
+            owner[i] = omp_get_thread_num();
+        }
+        arena_first_touch(&arena, population, sizeof(Individual), population_size, owner, omp_get_thread_num());
+        arena_first_touch(&arena, new_population, sizeof(Individual), population_size, owner, omp_get_thread_num());
+    }
 
     // Generate population
+    init_lines(seed);
     generate_population(population, population_size);
+    if (WARM_START) {
+        seed_population(population, population_size);
+    }
+
+    // Selection tables are refilled every generation
+    int elites[ELITE_COUNT];
 
     // Initialize iteration counter, timer, and best_individual
     int counter = 0;
     clock_t start = clock();
-    int best_individual = find_best_individual(population, population_size);
+    select_elites(population, population_size, elites, ELITE_COUNT);
+    int best_individual = elites[0];
+    double mutation_rate = MUTATION_RATE;
+    int stagnation = 0;
 
     // Print the initial state
-    printf("Initial Cube:\n");
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            for (int k = 0; k < N; k++) {
-                printf("%3d ", population[best_individual].cube[i][j][k]);
+    if (leader) {
+        printf("Initial Cube:\n");
+        for (int i = 0; i < N; i++) {
+            for (int j = 0; j < N; j++) {
+                for (int k = 0; k < N; k++) {
+                    printf("%3d ", population[best_individual].cube[i][j][k]);
+                }
+                printf("\n");
             }
             printf("\n");
         }
-        printf("\n");
+        printf("Initial Fitness: %d\n", population[best_individual].fitness);
+        printf("Population Size: %d\n", population_size);
+        printf("Memory Used: %zu bytes (%s pages)\n", arena.peak,
+               arena.pages == ARENA_PAGES_EXPLICIT ? "huge" : arena.pages == ARENA_PAGES_TRANSPARENT ? "transparent huge" : "normal");
+        printf("Iterations: %d\n", iterations);
+        if (ISLAND_MODEL) {
+            printf("Islands: %d (migration of %d individuals every %d generations)\n", transport.size, MIGRANTS,
+                   MIGRATION_INTERVAL);
+        }
+    }
+
+    // Every island publishes its own segment with one slot per breeding thread: the children it
+    // bred as iterations, the best child of the last generation and the best child it ever bred,
+    // the mutation rate in place of a temperature and the generations in place of restarts
+    int threads = omp_get_max_threads() < MAX_THREADS ? omp_get_max_threads() : MAX_THREADS;
+    TelemetrySegment *telemetry = TELEMETRY ? telemetry_open("Genetic", threads) : NULL;
+    long long thread_children[MAX_THREADS] = {0};
+    int thread_best[MAX_THREADS];
+    for (int t = 0; t < MAX_THREADS; t++) {
+        thread_best[t] = INT_MAX;
     }
-    printf("Initial Fitness: %d\n", population[best_individual].fitness);
-    printf("Population Size: %d\n", population_size);
-    printf("Iterations: %d\n", iterations);
 
     // Main loop
     while (counter < iterations) {
 
-        // Loop to generate new population
-        #pragma omp parallel for
-        for (int i = 0; i < 2; i++) {
-            new_population[i] = population[best_individual];
+        // Islands: take in the migrants that arrived during the last generation, send ours on
+        if (ISLAND_MODEL) {
+            if (receive_migrants(population, population_size) > 0) {
+                select_elites(population, population_size, elites, ELITE_COUNT);
+                best_individual = elites[0];
+            }
+            if (solution_found) {
+                break;
+            }
+            if (counter % MIGRATION_INTERVAL == 0) {
+                migrate(population, population_size, counter);
+            }
         }
 
-        // Loop to do crossover & mutation
-        #pragma omp parallel for
-        for (int i = 2; i < population_size; i++) {
-
-            // Initialize parents
-            int parent1_idx = generate_individual(population, population_size);
-            int parent2_idx = generate_individual(population, population_size);
+        // Loop to generate new population, the elites survive unchanged
+        for (int i = 0; i < ELITE_COUNT; i++) {
+            new_population[i] = population[elites[i]];
+        }
 
-            // Crossover & mutation
-            crossover(&population[parent1_idx], &population[parent2_idx], &new_population[i]);
-            mutation(&new_population[i]);
+        // Prepare the selection table of this generation
+        int children = population_size - ELITE_COUNT;
+        if (SELECTION != SELECTION_TOURNAMENT) {
+            build_selection_table(population, population_size, prefix, order);
+        }
+        if (SELECTION == SELECTION_SUS) {
+            sus_parents(prefix, order, population_size, parents, 2 * children);
         }
 
-        // Loop to generate population
-        #pragma omp parallel for
-        for (int i = 0; i < population_size; i++) {
-            population[i] = new_population[i];
+        // Loop to do crossover & mutation, every thread publishes its own children afterwards
+        #pragma omp parallel
+        {
+            int thread = omp_get_thread_num() % MAX_THREADS;
+            int bred = 0, generation_best = INT_MAX;
+            #pragma omp for schedule(static)
+            for (int i = ELITE_COUNT; i < population_size; i++) {
+
+                // Initialize parents
+                int parent1_idx, parent2_idx;
+                if (SELECTION == SELECTION_SUS) {
+                    parent1_idx = parents[2 * (i - ELITE_COUNT)];
+                    parent2_idx = parents[2 * (i - ELITE_COUNT) + 1];
+                } else if (SELECTION == SELECTION_RANK) {
+                    unsigned long long *lanes = mutation_rng[thread];
+                    parent1_idx = sample_individual(prefix, order, population_size, random_unit(lanes));
+                    parent2_idx = sample_individual(prefix, order, population_size, random_unit(lanes));
+                } else {
+                    parent1_idx = generate_individual(population, population_size);
+                    parent2_idx = generate_individual(population, population_size);
+                }
+
+                // Crossover & mutation
+                crossover(&population[parent1_idx], &population[parent2_idx], &new_population[i]);
+                mutation(&new_population[i], mutation_rate);
+                bred++;
+                if (new_population[i].fitness < generation_best) {
+                    generation_best = new_population[i].fitness;
+                }
+            }
+            if (bred > 0) {
+                thread_children[thread] += bred;
+                if (generation_best < thread_best[thread]) {
+                    thread_best[thread] = generation_best;
+                }
+                if ((counter + 1) % TELEMETRY_INTERVAL == 0) {
+                    telemetry_publish(telemetry, thread, "genetic", thread_children[thread], generation_best,
+                                      thread_best[thread], mutation_rate, counter + 1);
+                }
+            }
         }
 
-        // Find another best individual, and the number of iteration will increase
-        best_individual = find_best_individual(population, population_size);
+        // The new generation becomes the population, swapping the buffers instead of copying
+        Individual *temp = population;
+        population = new_population;
+        new_population = temp;
+
+        // Find the next elites, and the number of iteration will increase
+        int previous_best = population[0].fitness;  // Elite copy of the previous best
+        select_elites(population, population_size, elites, ELITE_COUNT);
+        best_individual = elites[0];
         counter++;
 
+        // Mutate harder while the best fitness stagnates, fall back to the base rate on progress
+        if (ADAPTIVE_MUTATION) {
+            if (population[best_individual].fitness < previous_best) {
+                stagnation = 0;
+                mutation_rate = MUTATION_RATE;
+            } else if (++stagnation >= STAGNATION_GENERATIONS) {
+                stagnation = 0;
+                mutation_rate = fmin(mutation_rate * 1.5, MAX_MUTATION_RATE);
+            }
+        }
+
         // If fitness of a best individual from a population reaches zero, the program will stop
         if (population[best_individual].fitness == 0) {
+            if (ISLAND_MODEL) {
+                migrate(population, population_size, counter);  // Tell the other islands to stop
+            }
             break;
         }
     }
 
     // Timer ends
     clock_t end = clock();
-    printf("Genetic Algorithm: Iterations=%d, Time=%.2f seconds, Best Cost=%d\n", counter, (double)(end - start) / CLOCKS_PER_SEC, population[best_individual].fitness);
+    for (int t = 0; t < threads; t++) {
+        telemetry_status(telemetry, t, TELEMETRY_DONE);
+    }
+    telemetry_close(telemetry);
+
+    // Islands: island 0 collects the best individual of every island, the others are done
+    if (ISLAND_MODEL) {
+        finish_island(&population[best_individual], counter);
+        if (!leader) {
+            transport_finalize(&transport);
+            arena_destroy(&arena);
+            return 0;
+        }
+        printf("\n%-8s %12s %14s\n", "Island", "Generations", "Best Fitness");
+        for (int r = 0; r < transport.size; r++) {
+            printf("%-8d %12d %14d\n", r, island_generations[r], island_fitness[r]);
+        }
+        printf("Messages of island 0: %lld sent, %lld dropped, %lld received\n", transport.sent, transport.dropped,
+               transport.received);
+    }
 
-    // Generate the final & optimized cube
+    // Generate the final & optimized cube, its absolute deviation is the cost that is reported
     for (int i = 0; i < N; i++) {
         for (int j = 0; j < N; j++) {
             for (int k = 0; k < N; k++) {
@@ -364,6 +1056,11 @@ int main() {
             }
         }
     }
+    int best_cost = deviation(cube);
+    printf("Genetic Algorithm: Iterations=%d, Time=%.2f seconds, Best Cost=%d\n", counter, (double)(end - start) / CLOCKS_PER_SEC, best_cost);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), population[best_individual].fitness);
+    }
 
     printf("Optimized Cube:\n");
     for (int i = 0; i < N; i++) {
@@ -375,6 +1072,31 @@ int main() {
         }
         printf("\n");
     }
+    printf("Canonical Hash: %016llx\n", canonical_hash(cube));
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    if (ISLAND_MODEL) {
+        snprintf(parameters, sizeof(parameters), "islands=%d population=%d iterations=%d", transport.size,
+                 population_size, iterations);
+    } else {
+        snprintf(parameters, sizeof(parameters), "population=%d iterations=%d", population_size, iterations);
+    }
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, cube, best_cost, "Genetic", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
+
+    // Append the trial summary, the data behind plotting/genetic_plot.py
+    const char *summary_names[] = {"population", "iterations", "time", "best_cost"};
+    double summary[] = {population_size, iterations, (double)(end - start) / CLOCKS_PER_SEC, best_cost};
+    if (!ISLAND_MODEL) {
+        trace_append_row("genetic_trials.trc", 4, summary_names, summary);
+    }
+
+    if (ISLAND_MODEL) {
+        transport_finalize(&transport);
+    }
+    arena_destroy(&arena);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cube.h"
+
+#define N 5
+#define TOTAL_NUMBERS (N * N * N)
+#define DIAGONALS 2                  // Plane diagonals checked, like PLANE_DIAGONALS in Exact.c
+#define MAX_ITERATIONS 2000000
+#define HISTORY_LENGTH 500           // L: a candidate is compared with the error of L iterations ago
+#define IDLE_LIMIT 200000            // Stop after this many iterations without a new best
+#define CANONICAL_PLANE_DIAGONALS 2  // The lines include the diagonals of every slice
+#define ARCHIVE 1                    // 1: store the final cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes.arc"     // Archive of final cubes shared by all solvers
+#define WARM_START 0                 // 1: start from one of the best archived cubes instead of a random one
+#define WARM_START_TOP_K 10          // Number of best archived cubes to pick the start from
+#define TELEMETRY 1                  // 1: publish progress in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 1000      // Iterations between two publishes
+
+#include "archive.h"
+#include "trace.h"
+#include "telemetry.h"
+
+int main() {
+    clock_t start_time = clock();
+    unsigned int seed = (unsigned int)time(0);
+    unsigned long long rng;
+    cube_seed(&rng, seed);
+
+    Cube current, best;
+    long long history[HISTORY_LENGTH];  // Ring buffer of the errors of the last HISTORY_LENGTH iterations
+    int cube[N][N][N];
+
+    if (!cube_init(&current, N, DIAGONALS) || !cube_init(&best, N, DIAGONALS)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+
+    // Initialize the cube with random values (or an archived cube)
+    if (WARM_START && archive_warm_start(ARCHIVE_FILE, WARM_START_TOP_K, cube)) {
+        memcpy(current.cells, cube, sizeof(cube));
+        cube_evaluate(&current);
+    } else {
+        cube_randomize(&current, &rng);
+    }
+    cube_copy(&current, &best);
+    for (int v = 0; v < HISTORY_LENGTH; v++) {
+        history[v] = current.error;
+    }
+
+    printf("Initial Cube:\n");
+    cube_print(&current);
+    printf("Initial Error: %lld\n", current.error);
+
+    TelemetrySegment *telemetry = TELEMETRY ? telemetry_open("LAHC", 1) : NULL;
+    int iterations = 0, idle = 0;
+    while (current.error > 0 && iterations < MAX_ITERATIONS && idle < IDLE_LIMIT) {
+        int slot = iterations % HISTORY_LENGTH;
+        iterations++;
+        idle++;
+
+        // Random swap, scored from the line sums through the two cells
+        int a = cube_rand_int(&rng, TOTAL_NUMBERS), b = cube_rand_int(&rng, TOTAL_NUMBERS);
+        long long delta = cube_swap_delta(&current, a, b);
+        long long candidate_error = current.error + delta;
+
+        // Late acceptance: no worse than now, or no worse than HISTORY_LENGTH iterations ago
+        if (candidate_error <= current.error || candidate_error <= history[slot]) {
+            cube_apply_swap(&current, a, b, delta);
+            if (current.error < best.error) {
+                cube_copy(&current, &best);
+                idle = 0;
+            }
+        }
+        history[slot] = current.error;
+
+        // Print status every 100000 iterations
+        if (iterations % 100000 == 0) {
+            printf("Iteration %d - Current Error: %lld - Best Error: %lld\n", iterations, current.error, best.error);
+        }
+        if (iterations % TELEMETRY_INTERVAL == 0) {
+            telemetry_publish(telemetry, 0, "lahc", iterations, current.error, best.error, 0, 0);
+        }
+    }
+    telemetry_publish(telemetry, 0, "lahc", iterations, current.error, best.error, 0, 0);
+    telemetry_status(telemetry, 0, TELEMETRY_DONE);
+    telemetry_close(telemetry);
+
+    double duration = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+    int best_error = (int)cube_deviation(&best);
+    memcpy(cube, best.cells, sizeof(cube));
+    printf("Final Cube after %d iterations:\n", iterations);
+    cube_print(&best);
+    printf("Final Error: %d\n", best_error);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %lld\n", objective_name(), best.error);
+    }
+    printf("Canonical Hash: %016llx\n", canonical_hash(cube));
+    printf("Program execution time: %.2f seconds\n", duration);
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "L=%d max_iter=%d", HISTORY_LENGTH, MAX_ITERATIONS);
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, cube, best_error, "LAHC", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
+
+    // Append the trial summary, one row per run so the history length can be tuned
+    const char *summary_names[] = {"history_length", "iterations", "time", "final_error"};
+    double summary[] = {HISTORY_LENGTH, iterations, duration, best_error};
+    trace_append_row("lahc_trials.trc", 4, summary_names, summary);
+
+    cube_free(&current);
+    cube_free(&best);
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <omp.h>
+
+#define N 5
+#define TOTAL_NUMBERS (N * N * N)
+#define MAGIC_NUMBER (N * (TOTAL_NUMBERS + 1)) / 2
+#define LANES 8                      // Chains stepped in lockstep by one thread, one per SIMD lane
+#define GROUPS 4                     // Lane groups, spread over the OpenMP threads
+#define CHAINS (LANES * GROUPS)
+#define MIN_TEMPERATURE 10.0         // Initial temperatures are spread geometrically between these
+#define MAX_TEMPERATURE 1000.0
+#define ALPHA 0.9999                 // Geometric cooling, the same for every chain
+#define MAX_ITERATIONS 100000
+#define NUM_LINES (3 * N * N + 2 + 6 * N)  // Lines checked by Annealing.c's evaluate()
+#define LINES_PER_CELL 13            // Upper bound of the lines through one cell
+#define TELEMETRY 1                  // 1: publish the progress of every thread in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 1000      // Iterations between two publishes
+
+#include "objective.h"
+#include "trace.h"
+#include "telemetry.h"
+
+// State of LANES chains, every array has the lane as its innermost index so one step of all
+// chains is a loop over contiguous lanes the compiler can vectorise
+typedef struct {
+    int cells[TOTAL_NUMBERS][LANES];
+    int line_sum[NUM_LINES + 1][LANES];  // The spare line NUM_LINES stays magic
+    int error[LANES];
+    int best_error[LANES];
+    int best_cells[TOTAL_NUMBERS][LANES];
+    double temperature[LANES];
+    unsigned long long rng[LANES];
+} ChainGroup;
+
+// Lines through every cell, padded to LINES_PER_CELL with the spare line, and the line shared
+// by two cells (the spare line if none)
+int cell_lines[TOTAL_NUMBERS][LINES_PER_CELL];
+int cell_num_lines[TOTAL_NUMBERS];
+int line_cells[NUM_LINES][N];
+int line_class[NUM_LINES + 1];  // Objective class of every line, the spare line counts as straight
+int shared_line[TOTAL_NUMBERS][TOTAL_NUMBERS];
+
+// Function prototypes
+void init_lines(void);
+void init_group(ChainGroup *g, int group, unsigned int seed);
+void step_group(ChainGroup *g);
+void print_cube(int cells[TOTAL_NUMBERS][LANES], int lane);
+void publish_group(TelemetrySegment *telemetry, ChainGroup *g, long long iterations);
+int best_deviation(ChainGroup *g, int lane);
+
+int main() {
+    unsigned int seed = (unsigned int)time(0);
+    srand(seed);
+
+    init_lines();
+    ChainGroup *groups = malloc(sizeof(ChainGroup) * GROUPS);
+    if (groups == NULL) {
+        printf("Not enough memory for the chains!\n");
+        exit(1);
+    }
+
+    double start = omp_get_wtime();
+
+    // Every thread initialises and runs its own groups and publishes them in its own slot
+    TelemetrySegment *telemetry = TELEMETRY ? telemetry_open("MultiChain", omp_get_max_threads()) : NULL;
+    #pragma omp parallel
+    {
+        long long done = 0;  // Iterations of the groups this thread already finished
+        #pragma omp for schedule(static)
+        for (int g = 0; g < GROUPS; g++) {
+            init_group(&groups[g], g, seed);
+            for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+                step_group(&groups[g]);
+                if ((iteration + 1) % TELEMETRY_INTERVAL == 0) {
+                    publish_group(telemetry, &groups[g], done + iteration + 1);
+                }
+            }
+            done += MAX_ITERATIONS;
+            publish_group(telemetry, &groups[g], done);
+        }
+    }
+    for (int t = 0; t < omp_get_max_threads(); t++) {
+        telemetry_status(telemetry, t, TELEMETRY_DONE);
+    }
+    telemetry_close(telemetry);
+
+    double duration = omp_get_wtime() - start;
+
+    // Summary over all chains, the best chain by the objective, the errors as absolute deviations
+    int best_chain = 0;
+    double mean = 0;
+    double initial_temperatures[CHAINS], best_errors[CHAINS], chain_numbers[CHAINS];
+    for (int c = 0; c < CHAINS; c++) {
+        ChainGroup *g = &groups[c / LANES];
+        chain_numbers[c] = c;
+        initial_temperatures[c] = MIN_TEMPERATURE * pow(MAX_TEMPERATURE / MIN_TEMPERATURE, (double)c / (CHAINS > 1 ? CHAINS - 1 : 1));
+        best_errors[c] = best_deviation(g, c % LANES);
+        mean += best_errors[c] / CHAINS;
+        if (g->best_error[c % LANES] < groups[best_chain / LANES].best_error[best_chain % LANES]) {
+            best_chain = c;
+        }
+    }
+
+    printf("Chains: %d (%d lanes x %d groups, %d threads), Iterations: %d\n", CHAINS, LANES, GROUPS,
+           omp_get_max_threads(), MAX_ITERATIONS);
+    printf("Time: %.2f seconds, %.0f chain iterations per second\n", duration, (double)CHAINS * MAX_ITERATIONS / duration);
+    printf("Best Error: %d (chain %d, T0=%.1f), Mean Best Error: %.1f\n", (int)best_errors[best_chain], best_chain,
+           initial_temperatures[best_chain], mean);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), groups[best_chain / LANES].best_error[best_chain % LANES]);
+    }
+    printf("Best Cube:\n");
+    print_cube(groups[best_chain / LANES].best_cells, best_chain % LANES);
+
+    // One row per chain, so the effect of the initial temperature can be plotted
+    const char *names[] = {"chain", "initial_temperature", "best_error"};
+    const char *dtypes[] = {"<f8", "<f8", "<f8"};
+    const void *columns[] = {chain_numbers, initial_temperatures, best_errors};
+    if (trace_write("multichain.trc", CHAINS, 3, names, dtypes, columns)) {
+        printf("Chain results saved to 'multichain.trc'.\n");
+    }
+
+    free(groups);
+    return 0;
+}
+
+// Add a line given its first cell and the step between consecutive cells
+void add_line(int *num_lines, int i, int j, int k, int di, int dj, int dk) {
+    for (int s = 0; s < N; s++) {
+        int cell = (i + s * di) * N * N + (j + s * dj) * N + (k + s * dk);
+        line_cells[*num_lines][s] = cell;
+        cell_lines[cell][cell_num_lines[cell]++] = *num_lines;
+    }
+    (*num_lines)++;
+}
+
+// Build the line tables in the same order as Annealing.c's evaluate()
+void init_lines(void) {
+    int num_lines = 0;
+    for (int i = 0; i < N; i++) for (int j = 0; j < N; j++) add_line(&num_lines, i, j, 0, 0, 0, 1);
+    for (int j = 0; j < N; j++) for (int k = 0; k < N; k++) add_line(&num_lines, 0, j, k, 1, 0, 0);
+    for (int i = 0; i < N; i++) for (int k = 0; k < N; k++) add_line(&num_lines, i, 0, k, 0, 1, 0);
+    add_line(&num_lines, 0, 0, 0, 1, 1, 1);
+    add_line(&num_lines, 0, 0, N - 1, 1, 1, -1);
+    for (int i = 0; i < N; i++) {
+        add_line(&num_lines, i, 0, 0, 0, 1, 1);
+        add_line(&num_lines, i, 0, N - 1, 0, 1, -1);
+    }
+    for (int j = 0; j < N; j++) {
+        add_line(&num_lines, 0, j, 0, 1, 0, 1);
+        add_line(&num_lines, N - 1, j, 0, -1, 0, 1);
+    }
+    for (int k = 0; k < N; k++) {
+        add_line(&num_lines, 0, 0, k, 1, 1, 0);
+        add_line(&num_lines, 0, N - 1, k, 1, -1, 0);
+    }
+
+    for (int l = 0; l <= NUM_LINES; l++) {
+        line_class[l] = objective_line_class(l, N);
+    }
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        for (int l = cell_num_lines[c]; l < LINES_PER_CELL; l++) {
+            cell_lines[c][l] = NUM_LINES;
+        }
+    }
+    for (int a = 0; a < TOTAL_NUMBERS; a++) {
+        for (int b = 0; b < TOTAL_NUMBERS; b++) {
+            shared_line[a][b] = NUM_LINES;
+        }
+    }
+    for (int l = 0; l < NUM_LINES; l++) {
+        for (int s = 0; s < N; s++) {
+            for (int t = 0; t < N; t++) {
+                if (s != t) shared_line[line_cells[l][s]][line_cells[l][t]] = l;
+            }
+        }
+    }
+}
+
+// Next value of a lane's xorshift64* stream
+static inline unsigned long long next_random(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+// Random cube, line sums and temperature for every lane of a group
+void init_group(ChainGroup *g, int group, unsigned int seed) {
+    for (int lane = 0; lane < LANES; lane++) {
+        int chain = group * LANES + lane;
+        g->rng[lane] = (seed + 1ULL) * 0x9E3779B97F4A7C15ULL + (chain + 1ULL) * 0xBF58476D1CE4E5B9ULL;
+        g->temperature[lane] = MIN_TEMPERATURE * pow(MAX_TEMPERATURE / MIN_TEMPERATURE, (double)chain / (CHAINS > 1 ? CHAINS - 1 : 1));
+
+        for (int c = 0; c < TOTAL_NUMBERS; c++) {
+            g->cells[c][lane] = c + 1;
+        }
+        for (int c = TOTAL_NUMBERS - 1; c > 0; c--) {
+            int r = (int)((next_random(&g->rng[lane]) >> 32) % (c + 1));
+            int temp = g->cells[c][lane];
+            g->cells[c][lane] = g->cells[r][lane];
+            g->cells[r][lane] = temp;
+        }
+
+        g->error[lane] = 0;
+        for (int l = 0; l < NUM_LINES; l++) {
+            int sum = 0;
+            for (int s = 0; s < N; s++) {
+                sum += g->cells[line_cells[l][s]][lane];
+            }
+            g->line_sum[l][lane] = sum;
+            g->error[lane] += objective_cost(sum - MAGIC_NUMBER, line_class[l]);
+        }
+        g->line_sum[NUM_LINES][lane] = MAGIC_NUMBER;
+        g->best_error[lane] = g->error[lane];
+        for (int c = 0; c < TOTAL_NUMBERS; c++) {
+            g->best_cells[c][lane] = g->cells[c][lane];
+        }
+    }
+}
+
+// One annealing iteration of every lane: draw a swap, score it from the line sums, run the
+// Metropolis test and apply the swap through a mask, so no lane takes a different branch
+void step_group(ChainGroup *g) {
+    int a[LANES], b[LANES], diff[LANES], delta[LANES], accept[LANES];
+    double u[LANES];
+
+    // Random swap and uniform number of every lane
+    #pragma omp simd
+    for (int lane = 0; lane < LANES; lane++) {
+        unsigned long long r1 = next_random(&g->rng[lane]), r2 = next_random(&g->rng[lane]);
+        a[lane] = (int)((r1 >> 32) * TOTAL_NUMBERS >> 32);
+        b[lane] = (int)((r1 & 0xFFFFFFFFULL) * TOTAL_NUMBERS >> 32);
+        u[lane] = (r2 >> 11) * (1.0 / 9007199254740992.0);
+        diff[lane] = g->cells[b[lane]][lane] - g->cells[a[lane]][lane];
+        delta[lane] = 0;
+    }
+
+    // Deltas over the padded line lists, then take back the padding and the shared line
+    for (int l = 0; l < LINES_PER_CELL; l++) {
+        #pragma omp simd
+        for (int lane = 0; lane < LANES; lane++) {
+            int la = cell_lines[a[lane]][l], lb = cell_lines[b[lane]][l];
+            delta[lane] += objective_line_delta(g->line_sum[la][lane] - MAGIC_NUMBER, diff[lane], line_class[la]);
+            delta[lane] += objective_line_delta(g->line_sum[lb][lane] - MAGIC_NUMBER, -diff[lane], line_class[lb]);
+        }
+    }
+    #pragma omp simd
+    for (int lane = 0; lane < LANES; lane++) {
+        int shared = shared_line[a[lane]][b[lane]];
+        int s = g->line_sum[shared][lane] - MAGIC_NUMBER;
+        delta[lane] -= (LINES_PER_CELL - cell_num_lines[a[lane]]) * objective_line_delta(0, diff[lane], OBJECTIVE_STRAIGHT);
+        delta[lane] -= (LINES_PER_CELL - cell_num_lines[b[lane]]) * objective_line_delta(0, -diff[lane], OBJECTIVE_STRAIGHT);
+        delta[lane] -= shared < NUM_LINES ? objective_line_delta(s, diff[lane], line_class[shared]) + objective_line_delta(s, -diff[lane], line_class[shared]) : 0;
+
+        // Metropolis test, u < exp(-delta / T) written as a comparison without branches
+        accept[lane] = delta[lane] <= 0 || u[lane] < exp(-delta[lane] / g->temperature[lane]);
+        g->temperature[lane] *= ALPHA;
+    }
+
+    // Masked application: a rejected lane swaps with a zero difference
+    for (int lane = 0; lane < LANES; lane++) {
+        int d = accept[lane] ? diff[lane] : 0;
+        for (int l = 0; l < LINES_PER_CELL; l++) {
+            g->line_sum[cell_lines[a[lane]][l]][lane] += d;
+            g->line_sum[cell_lines[b[lane]][l]][lane] -= d;
+        }
+        g->line_sum[NUM_LINES][lane] = MAGIC_NUMBER;  // Undo what the padding received
+        g->cells[a[lane]][lane] += d;
+        g->cells[b[lane]][lane] -= d;
+        g->error[lane] += accept[lane] ? delta[lane] : 0;
+    }
+
+    // Remember the best cube of every lane
+    for (int lane = 0; lane < LANES; lane++) {
+        if (g->error[lane] < g->best_error[lane]) {
+            g->best_error[lane] = g->error[lane];
+            for (int c = 0; c < TOTAL_NUMBERS; c++) {
+                g->best_cells[c][lane] = g->cells[c][lane];
+            }
+        }
+    }
+}
+
+// Print the cube of one lane
+void print_cube(int cells[TOTAL_NUMBERS][LANES], int lane) {
+    for (int i = 0; i < N; i++) {
+        printf("Slice %d:\n", i + 1);
+        for (int j = 0; j < N; j++) {
+            for (int k = 0; k < N; k++) {
+                printf("%3d ", cells[i * N * N + j * N + k][lane]);
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+}
+
+// Sum of absolute line deviations of the best cube of one lane, the error that is reported
+int best_deviation(ChainGroup *g, int lane) {
+    int line_sum[NUM_LINES];
+    for (int l = 0; l < NUM_LINES; l++) {
+        line_sum[l] = 0;
+        for (int s = 0; s < N; s++) {
+            line_sum[l] += g->best_cells[line_cells[l][s]][lane];
+        }
+    }
+    return objective_deviation(line_sum, NUM_LINES, MAGIC_NUMBER);
+}
+
+// Publish the lowest current and best errors of a group, the temperature of its coldest lane
+void publish_group(TelemetrySegment *telemetry, ChainGroup *g, long long iterations) {
+    int current = g->error[0], best = g->best_error[0];
+    double temperature = g->temperature[0];
+    for (int lane = 1; lane < LANES; lane++) {
+        if (g->error[lane] < current) current = g->error[lane];
+        if (g->best_error[lane] < best) best = g->best_error[lane];
+        if (g->temperature[lane] < temperature) temperature = g->temperature[lane];
+    }
+    telemetry_publish(telemetry, omp_get_thread_num(), "chains", iterations, current, best, temperature, 0);
+}
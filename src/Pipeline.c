@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "cube.h"
+#include "cubesolver.h"
+
+#define N 5
+#define TOTAL_NUMBERS (N * N * N)
+#define DIAGONALS 2                 // Plane diagonals checked, like PLANE_DIAGONALS in Exact.c
+#define CANONICAL_PLANE_DIAGONALS 2
+#define ARCHIVE 1                   // 1: store the best cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes.arc"    // Archive of final cubes shared by all solvers
+#define TARGET_ERROR 0              // Stop every stage once a cube this good is found
+
+// Stage 1: genetic algorithm, hands its best distinct cubes on while it keeps evolving
+#define POPULATION 200
+#define MUTATION_RATE 0.05
+#define TOURNAMENT_SIZE 5
+#define GA_GENERATIONS 2000         // Budget of the whole stage
+#define HANDOFF_INTERVAL 100        // Generations between two hand-offs
+#define HANDOFF_TOP_K 4             // Cubes handed on per hand-off
+
+// Stage 2: annealing chains started from the elites at a low temperature
+#define ANNEAL_THREADS 2
+#define ANNEAL_ITERATIONS 500000    // Budget of one chain
+#define ANNEAL_TEMPERATURE 20.0     // Elites are near-optimal, a hot start would only scramble them
+#define FINAL_TEMPERATURE 0.01
+
+// Stage 3: steepest descent over the full swap neighbourhood
+#define POLISH_THREADS 1
+#define POLISH_ITERATIONS 1000      // Budget of one descent, it usually stops at a local optimum first
+
+#define QUEUE_CAPACITY 8            // Cubes waiting between two stages, a full queue blocks the producer
+#define MAX_HANDOFFS ((GA_GENERATIONS / HANDOFF_INTERVAL + 1) * HANDOFF_TOP_K)
+#define TELEMETRY 1                 // 1: publish the progress of every stage thread in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 4096     // Annealing iterations between two publishes, a power of two
+
+#include "archive.h"
+#include "trace.h"
+#include "telemetry.h"
+
+// A cube moving down the pipeline, with the line sums it was scored with and its history
+typedef struct {
+    Cube cube;
+    long long ga_error;
+    long long anneal_error;
+} Handoff;
+
+// Bounded queue between two stages, closed once all its producers are finished
+typedef struct {
+    Handoff *slots;
+    int capacity;
+    int head;
+    int count;
+    int producers;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} Queue;
+
+// Per-stage statistics
+typedef struct {
+    const char *name;
+    int threads;
+    long long cubes;
+    long long best_error;
+    double busy;                    // Seconds spent working, summed over the stage's threads
+} Stage;
+
+Queue anneal_queue;
+Queue polish_queue;
+Stage stages[3] = {{"genetic", 1, 0, -1, 0}, {"annealing", ANNEAL_THREADS, 0, -1, 0},
+                   {"steepest", POLISH_THREADS, 0, -1, 0}};
+volatile int stop_search = 0;
+unsigned int seed;
+TelemetrySegment *telemetry;  // Slot 0 is the genetic stage, then the annealing chains, then the descents
+struct timespec start_time;
+
+// Best cube and one row per polished cube, guarded by result_lock
+pthread_mutex_t result_lock = PTHREAD_MUTEX_INITIALIZER;
+Cube best_cube;
+long long num_results = 0;
+int result_ga[MAX_HANDOFFS];
+int result_anneal[MAX_HANDOFFS];
+int result_polish[MAX_HANDOFFS];
+double result_time[MAX_HANDOFFS];
+
+// Function prototypes
+int handoff_init(Handoff *handoff);
+int queue_init(Queue *q, int capacity, int producers);
+int queue_push(Queue *q, const Handoff *item);
+int queue_pop(Queue *q, Handoff *item);
+void queue_close(Queue *q);
+void queue_destroy(Queue *q);
+void stop_pipeline(void);
+double elapsed(void);
+void finish_stage(int stage, long long cubes, long long best_error, double busy);
+int hand_off(const CubeSolver *ga, int handed[], unsigned long long seen[], int *num_seen, long long *best_error);
+CubeSolver *stage_solver(CubeSolverAlgorithm algorithm, unsigned long long stage_seed);
+void set_cells(Cube *cube, const int *cells);
+void *genetic_stage(void *arg);
+void *anneal_stage(void *arg);
+void *polish_stage(void *arg);
+
+// Main function
+int main() {
+    seed = (unsigned int)time(0);
+
+    if (!queue_init(&anneal_queue, QUEUE_CAPACITY, 1) || !queue_init(&polish_queue, QUEUE_CAPACITY, ANNEAL_THREADS)
+        || !cube_init(&best_cube, N, DIAGONALS)) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    best_cube.error = -1;
+
+    // Every stage runs at once, a stage starts on the first cube handed to it
+    printf("Pipeline: genetic (%d generations) -> %d annealing chains -> %d steepest descents\n",
+           GA_GENERATIONS, ANNEAL_THREADS, POLISH_THREADS);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    pthread_t genetic_thread, anneal_threads[ANNEAL_THREADS], polish_threads[POLISH_THREADS];
+    long ids[ANNEAL_THREADS > POLISH_THREADS ? ANNEAL_THREADS : POLISH_THREADS];
+    telemetry = TELEMETRY ? telemetry_open("Pipeline", 1 + ANNEAL_THREADS + POLISH_THREADS) : NULL;
+    canonical_init();  // The genetic stage hashes the cubes it hands on, build the tables before any thread
+    pthread_create(&genetic_thread, NULL, genetic_stage, NULL);
+    for (long t = 0; t < ANNEAL_THREADS; t++) {
+        ids[t] = t;
+        pthread_create(&anneal_threads[t], NULL, anneal_stage, &ids[t]);
+    }
+    for (long t = 0; t < POLISH_THREADS; t++) {
+        pthread_create(&polish_threads[t], NULL, polish_stage, &ids[t]);
+    }
+    pthread_join(genetic_thread, NULL);
+    for (int t = 0; t < ANNEAL_THREADS; t++) {
+        pthread_join(anneal_threads[t], NULL);
+    }
+    for (int t = 0; t < POLISH_THREADS; t++) {
+        pthread_join(polish_threads[t], NULL);
+    }
+    telemetry_close(telemetry);
+    double duration = elapsed();
+
+    // Report
+    printf("\n%-10s %8s %8s %12s %10s\n", "Stage", "Threads", "Cubes", "Best Error", "Busy (s)");
+    for (int s = 0; s < 3; s++) {
+        printf("%-10s %8d %8lld %12lld %10.2f\n", stages[s].name, stages[s].threads, stages[s].cubes,
+               stages[s].best_error, stages[s].busy);
+    }
+    printf("\nBest Cube:\n");
+    cube_print(&best_cube);
+    printf("Final Error: %lld%s\n", cube_deviation(&best_cube), best_cube.error <= TARGET_ERROR ? " (target reached)" : "");
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %lld\n", objective_name(), best_cube.error);
+    }
+    printf("Program execution time: %.2f seconds\n", duration);
+
+    // One row per polished cube: its error after each stage and when it came out
+    const char *names[] = {"ga_error", "anneal_error", "polish_error", "time"};
+    const char *dtypes[] = {"<i4", "<i4", "<i4", "<f8"};
+    const void *columns[] = {result_ga, result_anneal, result_polish, result_time};
+    if (trace_write("pipeline.trc", num_results, 4, names, dtypes, columns)) {
+        printf("Stage errors of every cube stored in 'pipeline.trc'.\n");
+    }
+
+    if (best_cube.error >= 0) {
+        int cube[N][N][N];
+        memcpy(cube, best_cube.cells, sizeof(cube));
+        printf("Canonical Hash: %016llx\n", canonical_hash(cube));
+
+        // Keep the best cube in the archive
+        char parameters[48];
+        snprintf(parameters, sizeof(parameters), "ga=%d k=%d sa=%d", GA_GENERATIONS, HANDOFF_TOP_K, ANNEAL_ITERATIONS);
+        if (ARCHIVE && archive_save(ARCHIVE_FILE, cube, (int)cube_deviation(&best_cube), "Pipeline", parameters, seed)) {
+            printf("Best cube stored in '%s'.\n", ARCHIVE_FILE);
+        }
+    }
+
+    queue_destroy(&anneal_queue);
+    queue_destroy(&polish_queue);
+    cube_free(&best_cube);
+    return 0;
+}
+
+// Allocate the cube of a hand-off
+int handoff_init(Handoff *handoff) {
+    memset(handoff, 0, sizeof(Handoff));
+    return cube_init(&handoff->cube, N, DIAGONALS);
+}
+
+// Allocate a queue with all of its cubes, nothing is allocated while the pipeline runs
+int queue_init(Queue *q, int capacity, int producers) {
+    memset(q, 0, sizeof(Queue));
+    q->slots = calloc(capacity, sizeof(Handoff));
+    if (q->slots == NULL) {
+        return 0;
+    }
+    q->capacity = capacity;
+    q->producers = producers;
+    for (int i = 0; i < capacity; i++) {
+        if (!handoff_init(&q->slots[i])) {
+            return 0;
+        }
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return 1;
+}
+
+// Copy a cube with its line sums into the queue, waits while the queue is full.
+// Returns 0 when the pipeline was stopped
+int queue_push(Queue *q, const Handoff *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == q->capacity && !stop_search) {
+        pthread_cond_wait(&q->not_full, &q->lock);
+    }
+    if (stop_search) {
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    Handoff *slot = &q->slots[(q->head + q->count) % q->capacity];
+    cube_copy(&item->cube, &slot->cube);
+    slot->ga_error = item->ga_error;
+    slot->anneal_error = item->anneal_error;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+// Take the oldest cube out of the queue, waits while the queue is empty.
+// Returns 0 once the queue is closed and drained or the pipeline was stopped
+int queue_pop(Queue *q, Handoff *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && q->producers > 0 && !stop_search) {
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    }
+    if (q->count == 0 || stop_search) {
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    Handoff *slot = &q->slots[q->head];
+    cube_copy(&slot->cube, &item->cube);
+    item->ga_error = slot->ga_error;
+    item->anneal_error = slot->anneal_error;
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+// A producer of the queue is finished, consumers drain what is left and stop
+void queue_close(Queue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->producers--;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Release the cubes of a queue
+void queue_destroy(Queue *q) {
+    for (int i = 0; i < q->capacity; i++) {
+        cube_free(&q->slots[i].cube);
+    }
+    free(q->slots);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+}
+
+// Stop every stage and wake the threads waiting on a queue
+void stop_pipeline(void) {
+    Queue *queues[] = {&anneal_queue, &polish_queue};
+    stop_search = 1;
+    for (int i = 0; i < 2; i++) {
+        pthread_mutex_lock(&queues[i]->lock);
+        pthread_cond_broadcast(&queues[i]->not_empty);
+        pthread_cond_broadcast(&queues[i]->not_full);
+        pthread_mutex_unlock(&queues[i]->lock);
+    }
+}
+
+// Seconds since the pipeline started
+double elapsed(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start_time.tv_sec) + (now.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+// Add the work of one thread to its stage
+void finish_stage(int stage, long long cubes, long long best_error, double busy) {
+    pthread_mutex_lock(&result_lock);
+    stages[stage].cubes += cubes;
+    stages[stage].busy += busy;
+    if (best_error >= 0 && (stages[stage].best_error < 0 || best_error < stages[stage].best_error)) {
+        stages[stage].best_error = best_error;
+    }
+    pthread_mutex_unlock(&result_lock);
+}
+
+// Library solver of a stage, with the parameters of this pipeline
+CubeSolver *stage_solver(CubeSolverAlgorithm algorithm, unsigned long long stage_seed) {
+    CubeSolverParams params;
+    cube_solver_default_params(&params, algorithm);
+    params.n = N;
+    params.diagonals = DIAGONALS;
+    params.seed = stage_seed;
+    params.population = POPULATION;
+    params.mutation_rate = MUTATION_RATE;
+    params.tournament_size = TOURNAMENT_SIZE;
+    params.initial_temperature = ANNEAL_TEMPERATURE;
+    params.alpha = pow(FINAL_TEMPERATURE / ANNEAL_TEMPERATURE, 1.0 / ANNEAL_ITERATIONS);
+    return cube_solver_create(&params);
+}
+
+// Copy cells from a solver into a cube and rebuild its line sums
+void set_cells(Cube *cube, const int *cells) {
+    memcpy(cube->cells, cells, sizeof(int) * cube->total);
+    cube_evaluate(cube);
+}
+
+// Pick the HANDOFF_TOP_K best individuals not handed on before (by canonical hash, so the
+// elites that survive many generations are sent once), returns how many were picked and sets
+// *best_error to the lowest error of the population
+int hand_off(const CubeSolver *ga, int handed[], unsigned long long seen[], int *num_seen, long long *best_error) {
+    char taken[POPULATION] = {0};
+    long long error[POPULATION];
+    int picked = 0;
+
+    for (int i = 0; i < POPULATION; i++) {
+        cube_solver_individual(ga, i, &error[i]);
+    }
+    for (int tries = 0; tries < POPULATION && picked < HANDOFF_TOP_K; tries++) {
+        int best = -1;
+        for (int i = 0; i < POPULATION; i++) {
+            if (!taken[i] && (best < 0 || error[i] < error[best])) {
+                best = i;
+            }
+        }
+        taken[best] = 1;
+        if (tries == 0) {
+            *best_error = error[best];
+        }
+
+        int cube[N][N][N];
+        memcpy(cube, cube_solver_individual(ga, best, NULL), sizeof(cube));
+        unsigned long long hash = canonical_hash(cube);
+        int duplicate = 0;
+        for (int s = 0; s < *num_seen && !duplicate; s++) {
+            duplicate = seen[s] == hash;
+        }
+        if (!duplicate && *num_seen < MAX_HANDOFFS) {
+            seen[(*num_seen)++] = hash;
+            handed[picked++] = best;
+        }
+    }
+    return picked;
+}
+
+// Stage 1: evolve the population of a library GA and hand the elites on every HANDOFF_INTERVAL
+// generations
+void *genetic_stage(void *arg) {
+    (void)arg;
+    CubeSolver *ga = stage_solver(CUBE_SOLVER_GENETIC, seed);
+    unsigned long long *seen = malloc(sizeof(unsigned long long) * MAX_HANDOFFS);
+    int num_seen = 0, handed[HANDOFF_TOP_K];
+    long long sent = 0, population_best = -1;
+    Handoff item;
+
+    int ok = ga != NULL && seen != NULL && handoff_init(&item);
+    double start = elapsed();
+    for (int generation = 1; ok && generation <= GA_GENERATIONS && !stop_search; generation++) {
+        cube_solver_step(ga, 1);
+        telemetry_publish(telemetry, 0, "genetic", generation, cube_solver_current_error(ga), cube_solver_error(ga), 0,
+                          sent);
+
+        // Hand the elites on with their line sums, annealing starts while evolution goes on
+        if (generation % HANDOFF_INTERVAL == 0 || generation == GA_GENERATIONS || cube_solver_done(ga)) {
+            int picked = hand_off(ga, handed, seen, &num_seen, &population_best);
+            for (int p = 0; p < picked; p++) {
+                set_cells(&item.cube, cube_solver_individual(ga, handed[p], NULL));
+                item.ga_error = item.cube.error;
+                if (!queue_push(&anneal_queue, &item)) break;
+                sent++;
+            }
+            printf("Generation %d - Best Error: %lld - %d cubes handed on\n", generation, population_best, picked);
+        }
+        if (cube_solver_done(ga)) break;
+    }
+    queue_close(&anneal_queue);
+    finish_stage(0, sent, ok ? cube_solver_error(ga) : -1, elapsed() - start);
+    telemetry_status(telemetry, 0, TELEMETRY_DONE);
+
+    if (item.cube.cells != NULL) cube_free(&item.cube);
+    cube_solver_destroy(ga);
+    free(seen);
+    return NULL;
+}
+
+// Stage 2: anneal every elite from a low temperature with a library solver restarted from it,
+// and hand the best cube of the chain on
+void *anneal_stage(void *arg) {
+    long id = *(long *)arg;
+    CubeSolver *chain = stage_solver(CUBE_SOLVER_ANNEALING, (unsigned long long)seed * 1000003ULL + id + 1);
+    Handoff item, best;
+    long long cubes = 0, best_error = -1;
+    double busy = 0;
+
+    if (chain == NULL || !handoff_init(&item) || !handoff_init(&best)) {
+        cube_solver_destroy(chain);
+        stop_pipeline();
+        return NULL;
+    }
+
+    while (queue_pop(&anneal_queue, &item)) {
+        double start = elapsed();
+        cube_solver_set_cube(chain, item.cube.cells);
+
+        // Run the chain in slices, so a stopped pipeline and the telemetry are seen in time
+        long long ran = 0;
+        while (ran < ANNEAL_ITERATIONS && !cube_solver_done(chain) && !stop_search) {
+            long long slice = ANNEAL_ITERATIONS - ran < TELEMETRY_INTERVAL ? ANNEAL_ITERATIONS - ran : TELEMETRY_INTERVAL;
+            long long done = cube_solver_step(chain, slice);
+            ran += done;
+            long long shown = best_error < 0 || cube_solver_error(chain) < best_error ? cube_solver_error(chain) : best_error;
+            telemetry_publish(telemetry, 1 + id, "annealing", cube_solver_iterations(chain),
+                              cube_solver_current_error(chain), shown, 0, cubes);
+            if (done < slice) break;
+        }
+
+        set_cells(&best.cube, cube_solver_best(chain));
+        best.ga_error = item.ga_error;
+        best.anneal_error = best.cube.error;
+        if (best_error < 0 || best.cube.error < best_error) best_error = best.cube.error;
+        cubes++;
+        busy += elapsed() - start;
+        if (!queue_push(&polish_queue, &best)) break;
+    }
+    queue_close(&polish_queue);
+    finish_stage(1, cubes, best_error, busy);
+    telemetry_status(telemetry, 1 + id, TELEMETRY_DONE);
+
+    cube_free(&item.cube);
+    cube_free(&best.cube);
+    cube_solver_destroy(chain);
+    return NULL;
+}
+
+// Stage 3: steepest descent with a library solver until no swap improves, then keep the result.
+// For N > 7 the library samples the neighbourhood instead of scanning every swap
+void *polish_stage(void *arg) {
+    int slot = 1 + ANNEAL_THREADS + (int)*(long *)arg;
+    CubeSolver *descent = stage_solver(CUBE_SOLVER_STEEPEST, (unsigned long long)seed * 1000033ULL + slot);
+    Handoff item;
+    long long cubes = 0, best_error = -1;
+    double busy = 0;
+
+    if (descent == NULL || !handoff_init(&item)) {
+        cube_solver_destroy(descent);
+        stop_pipeline();
+        return NULL;
+    }
+
+    while (queue_pop(&polish_queue, &item)) {
+        double start = elapsed();
+        Cube *current = &item.cube;
+
+        cube_solver_set_cube(descent, current->cells);
+        for (int iteration = 0; iteration < POLISH_ITERATIONS && !cube_solver_done(descent); iteration++) {
+            if (cube_solver_step(descent, 1) == 0) break;  // Local optimum
+            long long shown = best_error < 0 || cube_solver_error(descent) < best_error ? cube_solver_error(descent) : best_error;
+            telemetry_publish(telemetry, slot, "steepest", cube_solver_iterations(descent),
+                              cube_solver_current_error(descent), shown, 0, cubes);
+        }
+        set_cells(current, cube_solver_best(descent));
+
+        if (best_error < 0 || current->error < best_error) best_error = current->error;
+        cubes++;
+        busy += elapsed() - start;
+
+        pthread_mutex_lock(&result_lock);
+        if (num_results < MAX_HANDOFFS) {
+            result_ga[num_results] = (int)item.ga_error;
+            result_anneal[num_results] = (int)item.anneal_error;
+            result_polish[num_results] = (int)current->error;
+            result_time[num_results] = elapsed();
+            num_results++;
+        }
+        int improved = best_cube.error < 0 || current->error < best_cube.error;
+        if (improved) {
+            cube_copy(current, &best_cube);
+        }
+        pthread_mutex_unlock(&result_lock);
+
+        if (improved) {
+            printf("Polished cube: %lld -> %lld -> %lld\n", item.ga_error, item.anneal_error, current->error);
+        }
+        if (current->error <= TARGET_ERROR) {
+            stop_pipeline();
+        }
+    }
+    finish_stage(2, cubes, best_error, busy);
+    telemetry_status(telemetry, slot, TELEMETRY_DONE);
+
+    cube_free(&item.cube);
+    cube_solver_destroy(descent);
+    return NULL;
+}
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "cubesolver.h"
+#include "telemetry.h"
+
+#define N 5
+#define TOTAL_NUMBERS (N * N * N)
+#define DIAGONALS 2                 // Plane diagonals checked, like PLANE_DIAGONALS in Exact.c
+#define CANONICAL_PLANE_DIAGONALS 2
+#define ARCHIVE 1                   // 1: store the best cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes.arc"    // Archive of final cubes shared by all solvers
+#define NUM_THREADS 4               // Number of worker threads
+#define TARGET_ERROR 0              // Stop every strategy once a cube this good is found
+#define TIME_LIMIT 60.0             // Seconds before the portfolio gives up
+#define NUM_STRATEGIES 4
+#define TELEMETRY 1                 // 1: publish per-worker progress in shared memory for Watch.c
+
+#include "archive.h"
+
+// One algorithm of the portfolio and how its work is cut into tasks
+typedef struct {
+    const char *name;
+    CubeSolverAlgorithm algorithm;
+    int tasks;                      // Independent runs (chains, restarts, populations)
+    long long budget;               // Steps of one run
+    long long segment;              // Steps of one task, a run is re-queued after every segment
+} Strategy;
+
+Strategy strategies[NUM_STRATEGIES] = {
+    {"annealing", CUBE_SOLVER_ANNEALING, 4, 2000000, 20000},
+    {"sideways", CUBE_SOLVER_SIDEWAYS, 4, 20000, 50},
+    {"restart", CUBE_SOLVER_STEEPEST, 16, 10000, 50},     // Every restart is its own run
+    {"genetic", CUBE_SOLVER_GENETIC, 2, 5000, 20}          // Two separate populations, no migration between them
+};
+// A task is always a whole run: a neighbourhood scan (sideways, restart) is never split across
+// workers, and the genetic runs are not an island model, they never exchange individuals
+
+// A run in progress, created lazily by the first worker that executes it
+typedef struct {
+    int strategy;
+    unsigned long long seed;
+    CubeSolver *solver;
+    long long remaining;
+} Task;
+
+// Per-worker deque, the owner pops from the bottom and thieves steal from the top.
+// A run is in at most one deque at a time, so a ring of all runs never overflows
+typedef struct {
+    Task **tasks;
+    long long top;
+    long long bottom;
+    int capacity;
+    pthread_mutex_t lock;
+} Deque;
+
+// Per-worker statistics
+typedef struct {
+    int id;
+    long long segments;
+    long long steals;
+    long long steps;
+    long long best_error;
+} Worker;
+
+Deque deques[NUM_THREADS];
+Worker workers[NUM_THREADS];
+Task *task_store;
+int num_tasks;
+volatile int stop_search = 0;
+int unfinished_tasks;
+struct timespec start_time;
+TelemetrySegment *telemetry;
+
+// Best cube over all strategies
+pthread_mutex_t best_lock = PTHREAD_MUTEX_INITIALIZER;
+long long best_error = -1;
+long long best_deviation = -1;      // Absolute deviation of the best cube, what is reported and archived
+int best_strategy = -1;
+int best_cube[TOTAL_NUMBERS];
+long long strategy_best[NUM_STRATEGIES];
+long long strategy_steps[NUM_STRATEGIES];
+
+// Function prototypes
+void push_task(Deque *d, Task *task);
+Task *pop_task(Deque *d);
+Task *steal_task(Deque *d);
+void requeue_task(Deque *d, Task *task);
+double elapsed(void);
+void run_segment(Worker *w, Task *task);
+void *worker_main(void *arg);
+void print_cube(int cube[N][N][N]);
+
+// Main function
+int main() {
+    unsigned int seed = (unsigned int)time(0);
+    srand(seed);
+
+    // One task per run, dealt round-robin so every worker starts on a mix of strategies
+    for (int s = 0; s < NUM_STRATEGIES; s++) {
+        num_tasks += strategies[s].tasks;
+        strategy_best[s] = -1;
+    }
+    task_store = malloc(sizeof(Task) * num_tasks);
+    for (int t = 0; t < NUM_THREADS; t++) {
+        deques[t].capacity = num_tasks;
+        deques[t].tasks = malloc(sizeof(Task *) * num_tasks);
+        deques[t].top = 0;
+        deques[t].bottom = 0;
+        pthread_mutex_init(&deques[t].lock, NULL);
+        workers[t].id = t;
+        workers[t].best_error = -1;
+    }
+    int task = 0;
+    for (int s = 0; s < NUM_STRATEGIES; s++) {
+        for (int r = 0; r < strategies[s].tasks; r++, task++) {
+            task_store[task].strategy = s;
+            task_store[task].seed = (unsigned long long)seed * 1000003ULL + task;
+            task_store[task].solver = NULL;
+            task_store[task].remaining = strategies[s].budget;
+        }
+    }
+    for (int i = 0; i < num_tasks; i++) {
+        push_task(&deques[i % NUM_THREADS], &task_store[i]);
+    }
+    unfinished_tasks = num_tasks;
+
+    // Run the workers
+    printf("Portfolio: %d runs on %d threads, target error %d\n", num_tasks, NUM_THREADS, TARGET_ERROR);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    telemetry = TELEMETRY ? telemetry_open("Portfolio", NUM_THREADS) : NULL;
+    canonical_init();  // Symmetry tables are built once, before any worker thread exists
+    pthread_t threads[NUM_THREADS];
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_create(&threads[t], NULL, worker_main, &workers[t]);
+    }
+    long long segments = 0, steals = 0;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        segments += workers[t].segments;
+        steals += workers[t].steals;
+    }
+    double duration = elapsed();
+    telemetry_close(telemetry);
+
+    // Report
+    printf("\n%-10s %12s %14s\n", "Strategy", "Best Error", "Steps");
+    for (int s = 0; s < NUM_STRATEGIES; s++) {
+        printf("%-10s %12lld %14lld\n", strategies[s].name, strategy_best[s], strategy_steps[s]);
+    }
+    printf("Time: %.2f seconds, %lld segments, %lld steals\n", duration, segments, steals);
+    if (best_strategy < 0) {
+        // Every solver failed to allocate, there is no cube to report or archive
+        printf("\nNo run produced a cube\n");
+    } else {
+        printf("\nWinner: %s with error %lld%s\n", strategies[best_strategy].name, best_deviation,
+               best_error <= TARGET_ERROR ? " (target reached, other runs cancelled)" : "");
+
+        int cube[N][N][N];
+        memcpy(cube, best_cube, sizeof(cube));
+        printf("\nBest Cube:\n");
+        print_cube(cube);
+        printf("Canonical Hash: %016llx\n", canonical_hash(cube));
+
+        // Keep the best cube in the archive
+        char parameters[48];
+        snprintf(parameters, sizeof(parameters), "winner=%s threads=%d", strategies[best_strategy].name, NUM_THREADS);
+        if (ARCHIVE && archive_save(ARCHIVE_FILE, cube, (int)best_deviation, "Portfolio", parameters, seed)) {
+            printf("Best cube stored in '%s'.\n", ARCHIVE_FILE);
+        }
+    }
+
+    for (int i = 0; i < num_tasks; i++) {
+        cube_solver_destroy(task_store[i].solver);
+    }
+    for (int t = 0; t < NUM_THREADS; t++) {
+        free(deques[t].tasks);
+        pthread_mutex_destroy(&deques[t].lock);
+    }
+    free(task_store);
+    return best_strategy < 0;
+}
+
+// Push a task at the bottom of a deque
+void push_task(Deque *d, Task *task) {
+    pthread_mutex_lock(&d->lock);
+    d->tasks[(d->bottom % d->capacity + d->capacity) % d->capacity] = task;
+    d->bottom++;
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Pop a task from the bottom of the own deque
+Task *pop_task(Deque *d) {
+    Task *task = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        d->bottom--;
+        task = d->tasks[(d->bottom % d->capacity + d->capacity) % d->capacity];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return task;
+}
+
+// Steal a task from the top of another deque
+Task *steal_task(Deque *d) {
+    Task *task = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top) {
+        task = d->tasks[(d->top % d->capacity + d->capacity) % d->capacity];
+        d->top++;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return task;
+}
+
+// Put an unfinished task back at the top of a deque, behind the runs that are waiting,
+// so a worker cycles through its runs instead of finishing one before starting the next
+void requeue_task(Deque *d, Task *task) {
+    pthread_mutex_lock(&d->lock);
+    d->top--;
+    d->tasks[(d->top % d->capacity + d->capacity) % d->capacity] = task;
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Seconds since the portfolio started
+double elapsed(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start_time.tv_sec) + (now.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+// Run one segment of a run and publish its best cube
+void run_segment(Worker *w, Task *task) {
+    Strategy *strategy = &strategies[task->strategy];
+
+    // The worker that starts a run allocates it, so its memory is local to that worker
+    if (task->solver == NULL) {
+        CubeSolverParams params;
+        cube_solver_default_params(&params, strategy->algorithm);
+        params.n = N;
+        params.diagonals = DIAGONALS;
+        params.seed = task->seed;
+        task->solver = cube_solver_create(&params);
+        if (task->solver == NULL) {
+            task->remaining = 0;
+            return;
+        }
+    }
+
+    long long steps = strategy->segment < task->remaining ? strategy->segment : task->remaining;
+    long long done = cube_solver_step(task->solver, steps);
+    task->remaining = cube_solver_done(task->solver) ? 0 : task->remaining - steps;
+    w->segments++;
+    w->steps += done;
+
+    long long error = cube_solver_error(task->solver);
+    if (w->best_error < 0 || error < w->best_error) {
+        w->best_error = error;
+    }
+    telemetry_publish(telemetry, w->id, strategy->name, w->steps, cube_solver_current_error(task->solver),
+                      w->best_error, 0, cube_solver_restarts(task->solver));
+    pthread_mutex_lock(&best_lock);
+    strategy_steps[task->strategy] += done;
+    if (strategy_best[task->strategy] < 0 || error < strategy_best[task->strategy]) {
+        strategy_best[task->strategy] = error;
+    }
+    if (best_error < 0 || error < best_error) {
+        best_error = error;
+        best_deviation = cube_solver_deviation(task->solver);
+        best_strategy = task->strategy;
+        memcpy(best_cube, cube_solver_best(task->solver), sizeof(best_cube));
+        if (error <= TARGET_ERROR) {
+            stop_search = 1;
+        }
+    }
+    pthread_mutex_unlock(&best_lock);
+}
+
+// Worker loop: run a segment of an own run or steal a run from another worker, and put
+// unfinished runs back so idle workers can take them over
+void *worker_main(void *arg) {
+    Worker *w = (Worker *)arg;
+
+    while (!stop_search && __atomic_load_n(&unfinished_tasks, __ATOMIC_ACQUIRE) > 0) {
+        Task *task = pop_task(&deques[w->id]);
+        for (int t = 1; t < NUM_THREADS && task == NULL; t++) {
+            task = steal_task(&deques[(w->id + t) % NUM_THREADS]);
+            w->steals += task != NULL;
+        }
+        if (task == NULL) {
+            sched_yield();  // Every run left is being stepped by another worker
+            continue;
+        }
+
+        run_segment(w, task);
+        if (elapsed() > TIME_LIMIT) {
+            stop_search = 1;
+        }
+        if (task->remaining > 0) {
+            requeue_task(&deques[w->id], task);
+        } else {
+            __atomic_fetch_sub(&unfinished_tasks, 1, __ATOMIC_RELEASE);
+        }
+    }
+    telemetry_status(telemetry, w->id, TELEMETRY_DONE);
+    return NULL;
+}
+
+// Print the cube
+void print_cube(int cube[N][N][N]) {
+    for (int i = 0; i < N; i++) {
+        printf("Slice %d:\n", i + 1);
+        for (int j = 0; j < N; j++) {
+            for (int k = 0; k < N; k++) {
+                printf("%3d ", cube[i][j][k]);
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+}
@@ -8,32 +8,85 @@
 #define MAGIC_NUMBER (N * (TOTAL_NUMBERS + 1)) / 2
 #define MAX_ITERATIONS 500
 #define MAX_RESTARTS 10  // Limit for the number of restarts
+#define CANONICAL_PLANE_DIAGONALS 1  // evaluate() only checks the x-y slice diagonals
+#define ARCHIVE 1                    // 1: store the local optima and the final cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes_xy.arc"  // Archive shared by the solvers that only score x-y slice diagonals
+#define WARM_START 0                 // 1: start from one of the best archived cubes instead of a random one
+#define WARM_START_TOP_K 10          // Number of best archived cubes to pick the start from
+#define RESTART_RANDOM 0             // Restart from a new random cube at every local optimum
+#define RESTART_ILS 1                // Iterated local search: kick the local optimum and climb again
+#define RESTART_MODE RESTART_RANDOM  // Restart strategy
+#define MAX_KICKS 1000               // Limit for the number of kicks in ILS mode
+#define ILS_MAX_ITERATIONS 100000    // Limit for the steps of ILS mode, so MAX_KICKS is reached long before it
+#define KICK_SWAPS 16                // Random swaps of one kick, fewer are undone by the next climb
+#define KICK_LINE_SHUFFLE 0          // 1: a kick shuffles the cells of one random line instead
+#define ACCEPT_BETTER 0              // Kick from the best local optimum so far
+#define ACCEPT_RANDOM_WALK 1         // Kick from the latest local optimum
+#define ACCEPT_RESTART 2             // Like ACCEPT_BETTER, with a random restart after STAGNATION_KICKS
+#define ILS_ACCEPTANCE ACCEPT_BETTER // Which local optimum the next kick starts from
+#define STAGNATION_KICKS 100         // Kicks without a new best before ACCEPT_RESTART restarts
+#define NUM_LINES (3 * N * N + 2 + 2 * N)  // Lines checked by evaluate()
+#define LINES_PER_CELL 7             // Upper bound of the lines through one cell
+#define TELEMETRY 1                  // 1: publish progress in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 10        // Iterations between two publishes
+
+#include "archive.h"
+#include "objective.h"
+#include "telemetry.h"
 
 // Function prototypes
 void initialize_cube(int cube[N][N][N]);
 void print_cube(int cube[N][N][N]);
+int score_cube(int cube[N][N][N], int absolute);
 int evaluate(int cube[N][N][N]);
+int deviation(int cube[N][N][N]);
 void swap(int *a, int *b);
 void generate_all_neighbors(int cube[N][N][N], int best_cube[N][N][N], int *best_error);
 void copy_cube(int src[N][N][N], int dest[N][N][N]);
+void init_lines(void);
+int evaluate_lines(int cube[N][N][N], int line_sum[NUM_LINES]);
+int swap_delta(int cube[N][N][N], int line_sum[NUM_LINES], int a, int b);
+void apply_swap(int cube[N][N][N], int line_sum[NUM_LINES], int a, int b);
+void kick(int cube[N][N][N], int line_sum[NUM_LINES], int *error);
+void iterated_local_search(int cube[N][N][N], unsigned int seed);
+
+// Lines through every cell and cells of every line, built once by init_lines()
+int cell_lines[TOTAL_NUMBERS][LINES_PER_CELL];
+int cell_num_lines[TOTAL_NUMBERS];
+int line_cells[NUM_LINES][N];
+
+// Telemetry segment of this run, NULL when not publishing
+TelemetrySegment *telemetry;
 
 int main() {
-    srand(time(0));
+    unsigned int seed = (unsigned int)time(0);
+    srand(seed);
 
     int current_cube[N][N][N];
     int best_cube[N][N][N];
     int current_error, best_error;
     int restarts = 0;  // Counter for restarts
 
-    // Initialize the cube with random values
-    initialize_cube(current_cube);
+    // Initialize the cube with random values (or an archived cube)
+    if (!WARM_START || !archive_warm_start(ARCHIVE_FILE, WARM_START_TOP_K, current_cube)) {
+        initialize_cube(current_cube);
+    }
     current_error = evaluate(current_cube);
 
     printf("Initial Cube:\n");
     print_cube(current_cube);
     printf("Initial Error: %d\n", current_error);
 
+    telemetry = TELEMETRY ? telemetry_open("Restart", 1) : NULL;
+    if (RESTART_MODE == RESTART_ILS) {
+        iterated_local_search(current_cube, seed);
+        telemetry_status(telemetry, 0, TELEMETRY_DONE);
+        telemetry_close(telemetry);
+        return 0;
+    }
+
     int iterations = 0;
+    int lowest_error = current_error;  // Best error over all restarts, for the telemetry
     while (current_error > 0 && iterations < MAX_ITERATIONS && restarts < MAX_RESTARTS) {
         iterations++;
 
@@ -49,6 +102,9 @@ int main() {
         // If no improvement is found, restart the cube
         else {
             printf("Local optimum reached, restarting...\n");
+            if (ARCHIVE) {
+                archive_save(ARCHIVE_FILE, current_cube, deviation(current_cube), "Restart", "local_optimum", seed);
+            }
             restarts++;  // Increment restart count
             initialize_cube(current_cube);  // Reinitialize the cube with random values
             current_error = evaluate(current_cube);  // Recalculate the error after restart
@@ -59,7 +115,16 @@ int main() {
         if (iterations % 20 == 0) {
             printf("Iteration %d - Current Error: %d\n", iterations, current_error);
         }
+        if (current_error < lowest_error) {
+            lowest_error = current_error;
+        }
+        if (iterations % TELEMETRY_INTERVAL == 0) {
+            telemetry_publish(telemetry, 0, "restart", iterations, current_error, lowest_error, 0, restarts);
+        }
     }
+    telemetry_publish(telemetry, 0, "restart", iterations, current_error, lowest_error, 0, restarts);
+    telemetry_status(telemetry, 0, TELEMETRY_DONE);
+    telemetry_close(telemetry);
 
     if (current_error == 0) {
         printf("Solution found!\n");
@@ -71,7 +136,19 @@ int main() {
 
     printf("Final Cube after %d iterations and %d restarts:\n", iterations, restarts);
     print_cube(current_cube);
-    printf("Final Error: %d\n", current_error);
+    int final_error = deviation(current_cube);
+    printf("Final Error: %d\n", final_error);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), current_error);
+    }
+    printf("Canonical Hash: %016llx\n", canonical_hash(current_cube));
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "max_iter=%d max_restarts=%d", MAX_ITERATIONS, MAX_RESTARTS);
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, current_cube, final_error, "Restart", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
 
     return 0;
 }
@@ -114,8 +191,8 @@ void print_cube(int cube[N][N][N]) {
     }
 }
 
-// Evaluate the error of the cube (difference from MAGIC_NUMBER)
-int evaluate(int cube[N][N][N]) {
+// Score the lines of the cube with the objective, or by |sum - MAGIC_NUMBER| when absolute is set
+int score_cube(int cube[N][N][N], int absolute) {
     int error = 0;
     int sum;
 
@@ -126,7 +203,7 @@ int evaluate(int cube[N][N][N]) {
             for (int k = 0; k < N; k++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -137,7 +214,7 @@ int evaluate(int cube[N][N][N]) {
             for (int i = 0; i < N; i++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -148,7 +225,7 @@ int evaluate(int cube[N][N][N]) {
             for (int j = 0; j < N; j++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -157,13 +234,13 @@ int evaluate(int cube[N][N][N]) {
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][i];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     sum = 0;
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][N - i - 1];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     // Evaluate diagonal in slices
     for (int i = 0; i < N; i++) {
@@ -171,18 +248,28 @@ int evaluate(int cube[N][N][N]) {
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][j];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][N - j - 1];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     return error;
 }
 
+// Objective of the cube, the score the search minimises
+int evaluate(int cube[N][N][N]) {
+    return score_cube(cube, 0);
+}
+
+// Sum of absolute line deviations, the error that is printed and archived
+int deviation(int cube[N][N][N]) {
+    return score_cube(cube, 1);
+}
+
 // Swap two integers
 void swap(int *a, int *b) {
     int temp = *a;
@@ -234,3 +321,191 @@ void copy_cube(int src[N][N][N], int dest[N][N][N]) {
         }
     }
 }
+
+// Add a line given its first cell and the step between consecutive cells
+void add_line(int *num_lines, int i, int j, int k, int di, int dj, int dk) {
+    for (int s = 0; s < N; s++) {
+        int cell = (i + s * di) * N * N + (j + s * dj) * N + (k + s * dk);
+        line_cells[*num_lines][s] = cell;
+        cell_lines[cell][cell_num_lines[cell]++] = *num_lines;
+    }
+    (*num_lines)++;
+}
+
+// Build the line tables in the same order as evaluate()
+void init_lines(void) {
+    int num_lines = 0;
+    for (int i = 0; i < N; i++) for (int j = 0; j < N; j++) add_line(&num_lines, i, j, 0, 0, 0, 1);
+    for (int j = 0; j < N; j++) for (int k = 0; k < N; k++) add_line(&num_lines, 0, j, k, 1, 0, 0);
+    for (int i = 0; i < N; i++) for (int k = 0; k < N; k++) add_line(&num_lines, i, 0, k, 0, 1, 0);
+    add_line(&num_lines, 0, 0, 0, 1, 1, 1);
+    add_line(&num_lines, 0, 0, N - 1, 1, 1, -1);
+    for (int i = 0; i < N; i++) {
+        add_line(&num_lines, i, 0, 0, 0, 1, 1);
+        add_line(&num_lines, i, 0, N - 1, 0, 1, -1);
+    }
+}
+
+// Evaluate the cube with the build-time objective and remember the sum of every line
+int evaluate_lines(int cube[N][N][N], int line_sum[NUM_LINES]) {
+    const int *cells = &cube[0][0][0];
+    int error = 0;
+    for (int l = 0; l < NUM_LINES; l++) {
+        line_sum[l] = 0;
+        for (int s = 0; s < N; s++) {
+            line_sum[l] += cells[line_cells[l][s]];
+        }
+        error += objective_cost(line_sum[l] - MAGIC_NUMBER, objective_line_class(l, N));
+    }
+    return error;
+}
+
+// Error change if cells a and b were swapped, both line lists are sorted so shared lines are skipped
+int swap_delta(int cube[N][N][N], int line_sum[NUM_LINES], int a, int b) {
+    const int *cells = &cube[0][0][0];
+    int diff = cells[b] - cells[a];
+    int delta = 0, la = 0, lb = 0;
+
+    while (la < cell_num_lines[a] || lb < cell_num_lines[b]) {
+        int line, change;
+        if (lb >= cell_num_lines[b] || (la < cell_num_lines[a] && cell_lines[a][la] < cell_lines[b][lb])) {
+            line = cell_lines[a][la++];
+            change = diff;
+        } else if (la >= cell_num_lines[a] || cell_lines[b][lb] < cell_lines[a][la]) {
+            line = cell_lines[b][lb++];
+            change = -diff;
+        } else {
+            la++;
+            lb++;
+            continue;
+        }
+        delta += objective_line_delta(line_sum[line] - MAGIC_NUMBER, change, objective_line_class(line, N));
+    }
+    return delta;
+}
+
+// Swap cells a and b and update the line sums through them
+void apply_swap(int cube[N][N][N], int line_sum[NUM_LINES], int a, int b) {
+    int *cells = &cube[0][0][0];
+    int diff = cells[b] - cells[a];
+    for (int l = 0; l < cell_num_lines[a]; l++) line_sum[cell_lines[a][l]] += diff;
+    for (int l = 0; l < cell_num_lines[b]; l++) line_sum[cell_lines[b][l]] -= diff;
+    swap(&cells[a], &cells[b]);
+}
+
+// Kick the cube out of its basin, keeping the line sums and error up to date
+void kick(int cube[N][N][N], int line_sum[NUM_LINES], int *error) {
+    if (KICK_LINE_SHUFFLE) {
+        int line = rand() % NUM_LINES;
+        for (int s = N - 1; s > 0; s--) {
+            int a = line_cells[line][s], b = line_cells[line][rand() % (s + 1)];
+            *error += swap_delta(cube, line_sum, a, b);
+            apply_swap(cube, line_sum, a, b);
+        }
+    } else {
+        for (int m = 0; m < KICK_SWAPS; m++) {
+            int a = rand() % TOTAL_NUMBERS, b = rand() % TOTAL_NUMBERS;
+            *error += swap_delta(cube, line_sum, a, b);
+            apply_swap(cube, line_sum, a, b);
+        }
+    }
+}
+
+// Iterated local search: steepest ascent on swap deltas, and at every local optimum a kick
+// from the optimum chosen by ILS_ACCEPTANCE instead of a new random cube
+void iterated_local_search(int cube[N][N][N], unsigned int seed) {
+    int line_sum[NUM_LINES], home_sum[NUM_LINES];
+    int home_cube[N][N][N], best_cube[N][N][N];
+    int iterations = 0, kicks = 0, stagnation = 0;
+
+    init_lines();
+    int error = evaluate_lines(cube, line_sum);
+    int home_error = INT_MAX, best_error = error;
+    copy_cube(cube, best_cube);
+
+    while (error > 0 && iterations < ILS_MAX_ITERATIONS && kicks < MAX_KICKS) {
+        iterations++;
+        if (iterations % TELEMETRY_INTERVAL == 0) {
+            telemetry_publish(telemetry, 0, "ils", iterations, error, error < best_error ? error : best_error, 0, kicks);
+        }
+
+        // Best swap of the whole neighbourhood, scored from the line sums
+        int best_delta = 0, best_a = -1, best_b = -1;
+        for (int a = 0; a < TOTAL_NUMBERS; a++) {
+            for (int b = a + 1; b < TOTAL_NUMBERS; b++) {
+                int delta = swap_delta(cube, line_sum, a, b);
+                if (delta < best_delta) {
+                    best_delta = delta;
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+        if (best_a >= 0) {
+            apply_swap(cube, line_sum, best_a, best_b);
+            error += best_delta;
+            continue;
+        }
+
+        // Local optimum: remember it if it is the best so far
+        if (error < best_error) {
+            best_error = error;
+            copy_cube(cube, best_cube);
+            stagnation = 0;
+        } else {
+            stagnation++;
+        }
+
+        // Acceptance: choose the optimum the next kick starts from
+        if (ILS_ACCEPTANCE == ACCEPT_RANDOM_WALK || error < home_error) {
+            home_error = error;
+            copy_cube(cube, home_cube);
+            memcpy(home_sum, line_sum, sizeof(line_sum));
+        } else if (ILS_ACCEPTANCE == ACCEPT_RESTART && stagnation >= STAGNATION_KICKS) {
+            initialize_cube(cube);
+            error = evaluate_lines(cube, line_sum);
+            home_error = INT_MAX;
+            stagnation = 0;
+            kicks++;
+            continue;
+        } else {
+            error = home_error;
+            copy_cube(home_cube, cube);
+            memcpy(line_sum, home_sum, sizeof(line_sum));
+        }
+
+        kick(cube, line_sum, &error);
+        kicks++;
+    }
+
+    if (error < best_error) {
+        best_error = error;
+        copy_cube(cube, best_cube);
+    }
+    telemetry_publish(telemetry, 0, "ils", iterations, error, best_error, 0, kicks);
+    if (best_error == 0) {
+        printf("Solution found!\n");
+    } else if (kicks >= MAX_KICKS) {
+        printf("Reached maximum number of kicks. Stopping.\n");
+    } else {
+        printf("Reached maximum number of iterations. Stopping.\n");
+    }
+
+    int objective = best_error;
+    evaluate_lines(best_cube, line_sum);
+    best_error = objective_deviation(line_sum, NUM_LINES, MAGIC_NUMBER);
+    printf("Final Cube after %d iterations and %d kicks:\n", iterations, kicks);
+    print_cube(best_cube);
+    printf("Final Error: %d\n", best_error);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), objective);
+    }
+    printf("Canonical Hash: %016llx\n", canonical_hash(best_cube));
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "ils max_iter=%d kicks=%d", ILS_MAX_ITERATIONS, KICK_SWAPS);
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, best_cube, best_error, "Restart", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
+}
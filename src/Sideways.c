@@ -7,78 +7,190 @@
 #define TOTAL_NUMBERS (N * N * N)
 #define MAGIC_NUMBER (N * (TOTAL_NUMBERS + 1)) / 2
 #define MAX_SIDEWAYS_MOVES 5000  // Limit for sideways moves
+#define CANONICAL_PLANE_DIAGONALS 2  // evaluate() checks the diagonals of every slice
+#define ARCHIVE 1                    // 1: store the final cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes.arc"     // Archive of final cubes shared by all solvers
+#define WARM_START 0                 // 1: start from one of the best archived cubes instead of a random one
+#define WARM_START_TOP_K 10          // Number of best archived cubes to pick the start from
+#define TEXT_TRACE 0                 // 1: also write the old objective_function.txt text trace
+#define PLATEAU_SEARCH 1             // 1: pick equal moves uniformly and never revisit a state of the plateau
+#define VISITED_CAPACITY 16384       // Hash slots for the states of one plateau, a power of two > 2 * MAX_SIDEWAYS_MOVES
+#define TELEMETRY 1                  // 1: publish progress in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 10        // Iterations between two publishes
+
+#include "archive.h"
+#include "objective.h"
+#include "trace.h"
+#include "telemetry.h"
 
 // Function prototypes
 void initialize_cube(int cube[N][N][N]);
 void print_cube(int cube[N][N][N]);
+int score_cube(int cube[N][N][N], int absolute);
 int evaluate(int cube[N][N][N]);
+int deviation(int cube[N][N][N]);
 void swap(int *a, int *b);
 void generate_all_neighbors(int cube[N][N][N], int best_cube[N][N][N], int *best_error);
 void copy_cube(int src[N][N][N], int dest[N][N][N]);
+void init_zobrist(void);
+unsigned long long cube_hash(int cube[N][N][N]);
+int visited_insert(unsigned long long hash);
+int visited_contains(unsigned long long hash);
+void visited_clear(void);
+int plateau_neighbor(int cube[N][N][N], unsigned long long hash, int current_error, int *best_error, int *best_a,
+                     int *best_b);
+
+// Random key per (cell, value), the hash of a cube is the XOR of the keys of its cells, so a
+// swap changes it with four XORs (Zobrist hashing)
+unsigned long long zobrist[TOTAL_NUMBERS][TOTAL_NUMBERS + 1];
+
+// States already visited on the current plateau, open addressing, 0 marks an empty slot
+unsigned long long visited[VISITED_CAPACITY];
 
 int main() {
     clock_t start_time = clock();
-    srand(time(0));
+    unsigned int seed = (unsigned int)time(0);
+    srand(seed);
 
     int current_cube[N][N][N];
     int best_cube[N][N][N];
     int current_error, best_error;
     int sideways_moves = 0;
-
-    FILE *fptr = fopen("objective_function.txt", "w");
-    if (fptr == NULL) {
-        printf("Error opening file!\n");
+    int plateaus = 0;
+
+    // Error trace, grown as needed and written once at the end
+    int trace_capacity = 1024;
+    int *trace_errors = malloc(sizeof(int) * trace_capacity);
+    int *trace_iterations = malloc(sizeof(int) * trace_capacity);
+    if (trace_errors == NULL || trace_iterations == NULL) {
+        printf("Error allocating the trace!\n");
         exit(1);
     }
 
-    // Initialize the cube with random values
-    initialize_cube(current_cube);
+    // Initialize the cube with random values (or an archived cube)
+    if (!WARM_START || !archive_warm_start(ARCHIVE_FILE, WARM_START_TOP_K, current_cube)) {
+        initialize_cube(current_cube);
+    }
     current_error = evaluate(current_cube);
+    init_zobrist();
+    unsigned long long current_hash = cube_hash(current_cube);
+    visited_insert(current_hash);
 
     printf("Initial Cube:\n");
     print_cube(current_cube);
     printf("Initial Error: %d\n", current_error);
 
+    // Moves never make the cube worse, so the current error is also the best one
+    TelemetrySegment *telemetry = TELEMETRY ? telemetry_open("Sideways", 1) : NULL;
     int iterations = 0;
     while (current_error > 0) {
         iterations++;
 
-        // Generate all neighbors and choose the best one
-        best_error = current_error;
-        generate_all_neighbors(current_cube, best_cube, &best_error);
-
-        // If a better neighbor is found, reset sideways move counter
-        if (best_error < current_error) {
-            copy_cube(best_cube, current_cube);
-            current_error = best_error;
-            sideways_moves = 0;  // Reset sideways move counter
-        }
-        // If no improvement, but the neighbor has the same error (sideways move)
-        else if (best_error == current_error && sideways_moves < MAX_SIDEWAYS_MOVES) {
-            copy_cube(best_cube, current_cube);
-            current_error = best_error;
-            sideways_moves++;  // Increment sideways move counter
-            // printf("Sideways move: %d\n", sideways_moves);
+        // Plateau search: a better move leaves the plateau, otherwise move to an unvisited state of it
+        if (PLATEAU_SEARCH) {
+            int a, b;
+            int *cells = &current_cube[0][0][0];
+            int moves = plateau_neighbor(current_cube, current_hash, current_error, &best_error, &a, &b);
+            if (moves > 0 && (best_error < current_error || sideways_moves < MAX_SIDEWAYS_MOVES)) {
+                current_hash ^= zobrist[a][cells[a]] ^ zobrist[b][cells[b]] ^ zobrist[a][cells[b]] ^ zobrist[b][cells[a]];
+                swap(&cells[a], &cells[b]);
+                if (best_error < current_error) {
+                    sideways_moves = 0;
+                    visited_clear();
+                } else {
+                    sideways_moves++;
+                    if (sideways_moves == 1) plateaus++;
+                }
+                visited_insert(current_hash);
+                current_error = best_error;
+            } else if (moves == 0) {
+                printf("No unvisited sideways move from this state. Stopping.\n");
+                break;
+            } else {
+                printf("Reached local optimum or sideways move limit. Stopping.\n");
+                break;
+            }
+        } else {
+            // Generate all neighbors and choose the best one
+            best_error = current_error;
+            generate_all_neighbors(current_cube, best_cube, &best_error);
+
+            // If a better neighbor is found, reset sideways move counter
+            if (best_error < current_error) {
+                copy_cube(best_cube, current_cube);
+                current_error = best_error;
+                sideways_moves = 0;  // Reset sideways move counter
+            }
+            // If no improvement, but the neighbor has the same error (sideways move)
+            else if (best_error == current_error && sideways_moves < MAX_SIDEWAYS_MOVES) {
+                copy_cube(best_cube, current_cube);
+                current_error = best_error;
+                sideways_moves++;  // Increment sideways move counter
+                // printf("Sideways move: %d\n", sideways_moves);
+            }
+            // If no better neighbor and sideways limit is reached, stop (local optimum)
+            else {
+                printf("Reached local optimum or sideways move limit. Stopping.\n");
+                break;
+            }
         }
-        // If no better neighbor and sideways limit is reached, stop (local optimum)
-        else {
-            printf("Reached local optimum or sideways move limit. Stopping.\n");
-            break;
+
+        if (iterations > trace_capacity) {
+            trace_capacity *= 2;
+            trace_errors = realloc(trace_errors, sizeof(int) * trace_capacity);
+            trace_iterations = realloc(trace_iterations, sizeof(int) * trace_capacity);
         }
-        
-        fprintf(fptr, "%d %d\n", iterations, current_error);
+        trace_iterations[iterations - 1] = iterations;
+        trace_errors[iterations - 1] = current_error;
 
 
         // Print status every 10 iterations
         if (iterations % 1000 == 0) {
             printf("Iteration %d - Current Error: %d\n", iterations, current_error);
         }
+        if (iterations % TELEMETRY_INTERVAL == 0) {
+            telemetry_publish(telemetry, 0, "sideways", iterations, current_error, current_error, 0, plateaus);
+        }
     }
+    telemetry_publish(telemetry, 0, "sideways", iterations, current_error, current_error, 0, plateaus);
+    telemetry_status(telemetry, 0, TELEMETRY_DONE);
+    telemetry_close(telemetry);
 
     printf("Final Cube after %d iterations:\n", iterations);
     print_cube(current_cube);
-    printf("Final Error: %d\n", current_error);
-    fclose(fptr);
+    int final_error = deviation(current_cube);
+    printf("Final Error: %d\n", final_error);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), current_error);
+    }
+    if (PLATEAU_SEARCH) {
+        printf("Plateaus explored: %d\n", plateaus);
+    }
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "max_sideways=%d", MAX_SIDEWAYS_MOVES);
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, current_cube, final_error, "Sideways", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
+
+    // The last iteration stopped the search without a move, it is not part of the trace
+    int recorded = current_error > 0 ? iterations - 1 : iterations;
+    const char *names[] = {"iteration", "error"};
+    const char *dtypes[] = {"<i4", "<i4"};
+    const void *columns[] = {trace_iterations, trace_errors};
+    if (trace_write("objective_function.trc", recorded, 2, names, dtypes, columns)) {
+        printf("Objective function trace saved to 'objective_function.trc'.\n");
+    }
+    if (TEXT_TRACE) {
+        FILE *fptr = fopen("objective_function.txt", "w");
+        for (int i = 0; i < recorded; i++) {
+            fprintf(fptr, "%d %d\n", trace_iterations[i], trace_errors[i]);
+        }
+        fclose(fptr);
+    }
+    free(trace_errors);
+    free(trace_iterations);
 
     // Record the end time
     clock_t end_time = clock();
@@ -88,6 +200,11 @@ int main() {
 
     printf("Program execution time: %.2f seconds\n", duration);
 
+    // Append the trial summary
+    const char *summary_names[] = {"iterations", "time", "final_error", "sideways_moves"};
+    double summary[] = {iterations, duration, current_error, sideways_moves};
+    trace_append_row("sideways_trials.trc", 4, summary_names, summary);
+
     return 0;
 }
 
@@ -146,8 +263,8 @@ void print_cube(int cube[N][N][N]) {
     }
 }
 
-// Evaluate the error of the cube (difference from MAGIC_NUMBER)
-int evaluate(int cube[N][N][N]) {
+// Score the lines of the cube with the objective, or by |sum - MAGIC_NUMBER| when absolute is set
+int score_cube(int cube[N][N][N], int absolute) {
     int error = 0;
     int sum;
 
@@ -158,7 +275,7 @@ int evaluate(int cube[N][N][N]) {
             for (int k = 0; k < N; k++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -169,7 +286,7 @@ int evaluate(int cube[N][N][N]) {
             for (int i = 0; i < N; i++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -180,7 +297,7 @@ int evaluate(int cube[N][N][N]) {
             for (int j = 0; j < N; j++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -189,13 +306,13 @@ int evaluate(int cube[N][N][N]) {
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][i];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     sum = 0;
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][N - i - 1];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     // Evaluate diagonals in horizontal (x-y) slices
     for (int i = 0; i < N; i++) {
@@ -203,13 +320,13 @@ int evaluate(int cube[N][N][N]) {
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][j];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][N - j - 1];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     // Evaluate diagonals in vertical (y-z) slices
@@ -218,13 +335,13 @@ int evaluate(int cube[N][N][N]) {
         for (int k = 0; k < N; k++) {
             sum += cube[k][j][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int k = 0; k < N; k++) {
             sum += cube[N - k - 1][j][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     // Evaluate diagonals in vertical (x-z) slices
@@ -233,18 +350,28 @@ int evaluate(int cube[N][N][N]) {
         for (int i = 0; i < N; i++) {
             sum += cube[i][i][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int i = 0; i < N; i++) {
             sum += cube[i][N - i - 1][k];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     return error;
 }
 
+// Objective of the cube, the score the search minimises
+int evaluate(int cube[N][N][N]) {
+    return score_cube(cube, 0);
+}
+
+// Sum of absolute line deviations, the error that is printed and archived
+int deviation(int cube[N][N][N]) {
+    return score_cube(cube, 1);
+}
+
 // Swap two integers
 void swap(int *a, int *b) {
     int temp = *a;
@@ -296,3 +423,96 @@ void copy_cube(int src[N][N][N], int dest[N][N][N]) {
         }
     }
 }
+
+// Fill the Zobrist keys with 64-bit random numbers
+void init_zobrist(void) {
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        for (int v = 0; v <= TOTAL_NUMBERS; v++) {
+            zobrist[c][v] = 0;
+            for (int part = 0; part < 4; part++) {
+                zobrist[c][v] = (zobrist[c][v] << 16) ^ (unsigned long long)(rand() & 0xFFFF);
+            }
+        }
+    }
+}
+
+// Hash of a whole cube, later kept up to date one swap at a time
+unsigned long long cube_hash(int cube[N][N][N]) {
+    const int *cells = &cube[0][0][0];
+    unsigned long long hash = 0;
+    for (int c = 0; c < TOTAL_NUMBERS; c++) {
+        hash ^= zobrist[c][cells[c]];
+    }
+    return hash;
+}
+
+// Add a state to the visited set, returns 0 when it was already there or the set is full
+int visited_insert(unsigned long long hash) {
+    if (hash == 0) hash = 1;
+    for (int probe = 0; probe < VISITED_CAPACITY; probe++) {
+        unsigned long long *slot = &visited[(hash + probe) & (VISITED_CAPACITY - 1)];
+        if (*slot == hash) return 0;
+        if (*slot == 0) {
+            *slot = hash;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 1 if the state was visited on the current plateau
+int visited_contains(unsigned long long hash) {
+    if (hash == 0) hash = 1;
+    for (int probe = 0; probe < VISITED_CAPACITY; probe++) {
+        unsigned long long slot = visited[(hash + probe) & (VISITED_CAPACITY - 1)];
+        if (slot == hash) return 1;
+        if (slot == 0) return 0;
+    }
+    return 0;
+}
+
+// Forget the states of the plateau that was just left
+void visited_clear(void) {
+    for (int i = 0; i < VISITED_CAPACITY; i++) {
+        visited[i] = 0;
+    }
+}
+
+// Scan all swaps for the best error and pick one of the moves reaching it uniformly by
+// reservoir sampling, so the set of equal moves is never stored. Equal-error moves into a
+// state already visited on the plateau are skipped. Returns the number of candidate moves
+int plateau_neighbor(int cube[N][N][N], unsigned long long hash, int current_error, int *best_error, int *best_a,
+                     int *best_b) {
+    int *cells = &cube[0][0][0];
+    int moves = 0;
+    *best_error = current_error;
+
+    for (int a = 0; a < TOTAL_NUMBERS; a++) {
+        for (int b = a + 1; b < TOTAL_NUMBERS; b++) {
+            swap(&cells[a], &cells[b]);
+            int neighbor_error = evaluate(cube);
+            swap(&cells[a], &cells[b]);
+
+            if (neighbor_error > *best_error) {
+                continue;
+            }
+            if (neighbor_error == current_error) {
+                unsigned long long neighbor_hash = hash ^ zobrist[a][cells[a]] ^ zobrist[b][cells[b]]
+                                                   ^ zobrist[a][cells[b]] ^ zobrist[b][cells[a]];
+                if (visited_contains(neighbor_hash)) {
+                    continue;
+                }
+            }
+            if (neighbor_error < *best_error) {
+                *best_error = neighbor_error;
+                moves = 0;
+            }
+            moves++;
+            if (rand() % moves == 0) {
+                *best_a = a;
+                *best_b = b;
+            }
+        }
+    }
+    return moves;
+}
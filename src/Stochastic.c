@@ -7,30 +7,48 @@
 #define TOTAL_NUMBERS (N * N * N)
 #define MAGIC_NUMBER (N * (TOTAL_NUMBERS + 1)) / 2
 #define MAX_ITERATIONS 1000
+#define CANONICAL_PLANE_DIAGONALS 1  // evaluate() only checks the x-y slice diagonals
+#define ARCHIVE 1                    // 1: store the final cube in ARCHIVE_FILE
+#define ARCHIVE_FILE "cubes_xy.arc"  // Archive shared by the solvers that only score x-y slice diagonals
+#define WARM_START 0                 // 1: start from one of the best archived cubes instead of a random one
+#define WARM_START_TOP_K 10          // Number of best archived cubes to pick the start from
+#define TELEMETRY 1                  // 1: publish progress in shared memory for Watch.c
+#define TELEMETRY_INTERVAL 10        // Iterations between two publishes
+
+#include "archive.h"
+#include "objective.h"
+#include "telemetry.h"
 
 // Function prototypes
 void initialize_cube(int cube[N][N][N]);
 void print_cube(int cube[N][N][N]);
+int score_cube(int cube[N][N][N], int absolute);
 int evaluate(int cube[N][N][N]);
+int deviation(int cube[N][N][N]);
 void swap(int *a, int *b);
 void generate_random_neighbor(int cube[N][N][N], int neighbor[N][N][N]);
 void copy_cube(int src[N][N][N], int dest[N][N][N]);
 
 int main() {
-    srand(time(0));
+    unsigned int seed = (unsigned int)time(0);
+    srand(seed);
 
     int current_cube[N][N][N];
     int neighbor_cube[N][N][N];
     int current_error, neighbor_error;
 
-    // Initialize the cube with random values
-    initialize_cube(current_cube);
+    // Initialize the cube with random values (or an archived cube)
+    if (!WARM_START || !archive_warm_start(ARCHIVE_FILE, WARM_START_TOP_K, current_cube)) {
+        initialize_cube(current_cube);
+    }
     current_error = evaluate(current_cube);
 
     printf("Initial Cube:\n");
     print_cube(current_cube);
     printf("Initial Error: %d\n", current_error);
 
+    // Moves never make the cube worse, so the current error is also the best one
+    TelemetrySegment *telemetry = TELEMETRY ? telemetry_open("Stochastic", 1) : NULL;
     int iterations = 0;
     while (current_error > 0 && iterations < MAX_ITERATIONS) {
         iterations++;
@@ -49,11 +67,28 @@ int main() {
         if (iterations % 50 == 0) {
             printf("Iteration %d - Current Error: %d\n", iterations, current_error);
         }
+        if (iterations % TELEMETRY_INTERVAL == 0) {
+            telemetry_publish(telemetry, 0, "stochastic", iterations, current_error, current_error, 0, 0);
+        }
     }
+    telemetry_publish(telemetry, 0, "stochastic", iterations, current_error, current_error, 0, 0);
+    telemetry_status(telemetry, 0, TELEMETRY_DONE);
+    telemetry_close(telemetry);
 
     printf("Final Cube after %d iterations:\n", iterations);
     print_cube(current_cube);
-    printf("Final Error: %d\n", current_error);
+    int final_error = deviation(current_cube);
+    printf("Final Error: %d\n", final_error);
+    if (OBJECTIVE != OBJECTIVE_ABSOLUTE) {
+        printf("Objective (%s): %d\n", objective_name(), current_error);
+    }
+
+    // Keep the final cube in the archive
+    char parameters[48];
+    snprintf(parameters, sizeof(parameters), "max_iter=%d", MAX_ITERATIONS);
+    if (ARCHIVE && archive_save(ARCHIVE_FILE, current_cube, final_error, "Stochastic", parameters, seed)) {
+        printf("Final cube stored in '%s'.\n", ARCHIVE_FILE);
+    }
 
     return 0;
 }
@@ -96,8 +131,8 @@ void print_cube(int cube[N][N][N]) {
     }
 }
 
-// Evaluate the error of the cube (difference from MAGIC_NUMBER)
-int evaluate(int cube[N][N][N]) {
+// Score the lines of the cube with the objective, or by |sum - MAGIC_NUMBER| when absolute is set
+int score_cube(int cube[N][N][N], int absolute) {
     int error = 0;
     int sum;
 
@@ -108,7 +143,7 @@ int evaluate(int cube[N][N][N]) {
             for (int k = 0; k < N; k++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -119,7 +154,7 @@ int evaluate(int cube[N][N][N]) {
             for (int i = 0; i < N; i++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -130,7 +165,7 @@ int evaluate(int cube[N][N][N]) {
             for (int j = 0; j < N; j++) {
                 sum += cube[i][j][k];
             }
-            error += abs(sum - MAGIC_NUMBER);
+            error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_STRAIGHT, absolute);
         }
     }
 
@@ -139,13 +174,13 @@ int evaluate(int cube[N][N][N]) {
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][i];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     sum = 0;
     for (int i = 0; i < N; i++) {
         sum += cube[i][i][N-i-1];
     }
-    error += abs(sum - MAGIC_NUMBER);
+    error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_SPACE, absolute);
 
     // Evaluate diagonal in slices
     for (int i = 0; i < N; i++) {
@@ -153,18 +188,28 @@ int evaluate(int cube[N][N][N]) {
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][j];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
 
         sum = 0;
         for (int j = 0; j < N; j++) {
             sum += cube[i][j][N-j-1];
         }
-        error += abs(sum - MAGIC_NUMBER);
+        error += objective_score(sum - MAGIC_NUMBER, OBJECTIVE_PLANE, absolute);
     }
 
     return error;
 }
 
+// Objective of the cube, the score the search minimises
+int evaluate(int cube[N][N][N]) {
+    return score_cube(cube, 0);
+}
+
+// Sum of absolute line deviations, the error that is printed and archived
+int deviation(int cube[N][N][N]) {
+    return score_cube(cube, 1);
+}
+
 // Swap two integers
 void swap(int *a, int *b) {
     int temp = *a;
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+#include "telemetry.h"
+
+#define SHM_DIRECTORY "/dev/shm"
+#define MAX_SAMPLES 1024            // Previous samples kept to compute iteration rates
+#define DEFAULT_INTERVAL 1.0        // Seconds between two refreshes
+#define DEFAULT_STALL 30.0          // Seconds without a new best before a run counts as stalled
+
+// Previous sample of one thread, for the iteration rate
+typedef struct {
+    int pid;
+    int thread;
+    int64_t iterations;
+    double updated;
+} Sample;
+
+Sample samples[MAX_SAMPLES];
+int num_samples = 0;
+
+// Function prototypes
+void usage(const char *program);
+int process_alive(int pid);
+double thread_rate(int pid, int thread, const TelemetrySlot *slot, double started);
+int show_segment(const char *name, double stall_seconds, int kill_stalled, int clean);
+int show_all(int only_pid, double stall_seconds, int kill_stalled, int clean);
+
+// Main function: watch the telemetry of running solvers
+//   ./watch [pid] [-i seconds] [--once] [--stall seconds] [--kill-stalled] [--clean]
+int main(int argc, char *argv[]) {
+    int only_pid = 0, once = 0, kill_stalled = 0, clean = 0;
+    double interval = DEFAULT_INTERVAL, stall_seconds = DEFAULT_STALL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            interval = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--stall") == 0 && i + 1 < argc) {
+            stall_seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--once") == 0) {
+            once = 1;
+        } else if (strcmp(argv[i], "--kill-stalled") == 0) {
+            kill_stalled = 1;
+        } else if (strcmp(argv[i], "--clean") == 0) {
+            clean = 1;
+        } else if (argv[i][0] != '-' && atoi(argv[i]) > 0) {
+            only_pid = atoi(argv[i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    while (1) {
+        if (!once) {
+            printf("\033[H\033[2J");  // Clear the terminal
+        }
+        int shown = show_all(only_pid, stall_seconds, kill_stalled, clean);
+        if (shown == 0) {
+            printf(only_pid ? "No telemetry for process %d.\n" : "No solver is publishing telemetry.\n", only_pid);
+        }
+        fflush(stdout);
+        if (once || (only_pid && shown == 0)) {
+            break;
+        }
+        struct timespec pause = {(time_t)interval, (long)((interval - (time_t)interval) * 1e9)};
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+// Print the command line options
+void usage(const char *program) {
+    printf("Usage: %s [pid] [-i seconds] [--once] [--stall seconds] [--kill-stalled] [--clean]\n", program);
+    printf("  pid             only watch this process\n");
+    printf("  -i seconds      refresh interval (default %.0f)\n", DEFAULT_INTERVAL);
+    printf("  --once          print one snapshot and exit\n");
+    printf("  --stall seconds a run without a new best for this long is stalled (default %.0f)\n", DEFAULT_STALL);
+    printf("  --kill-stalled  send SIGTERM to stalled runs\n");
+    printf("  --clean         remove segments left behind by processes that died\n");
+}
+
+// 1 if the process still exists
+int process_alive(int pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Iterations per second of a thread since its previous sample, or since the start for the first one
+double thread_rate(int pid, int thread, const TelemetrySlot *slot, double started) {
+    for (int s = 0; s < num_samples; s++) {
+        if (samples[s].pid == pid && samples[s].thread == thread) {
+            double rate = 0;
+            if (slot->updated > samples[s].updated) {
+                rate = (slot->iterations - samples[s].iterations) / (slot->updated - samples[s].updated);
+            }
+            if (slot->updated != samples[s].updated) {
+                samples[s].iterations = slot->iterations;
+                samples[s].updated = slot->updated;
+            }
+            return rate;
+        }
+    }
+    if (num_samples < MAX_SAMPLES) {
+        samples[num_samples++] = (Sample){pid, thread, slot->iterations, slot->updated};
+    }
+    return slot->updated > started ? slot->iterations / (slot->updated - started) : 0;
+}
+
+// Print one segment, returns 1 if it belonged to a solver (running or dead)
+int show_segment(const char *name, double stall_seconds, int kill_stalled, int clean) {
+    char path[300];
+    snprintf(path, sizeof(path), "/%s", name);
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    // A segment still being sized (or not ours) would fault on the first read past its end
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(TelemetrySegment)) {
+        close(fd);
+        return 0;
+    }
+    TelemetrySegment *segment = mmap(NULL, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        return 0;
+    }
+    if (__atomic_load_n(&segment->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC
+        || segment->version != TELEMETRY_VERSION) {
+        munmap(segment, sizeof(TelemetrySegment));
+        return 0;
+    }
+
+    double now = telemetry_now();
+    int pid = segment->pid;
+    int alive = process_alive(pid);
+    printf("PID %d  %s  up %.0f s%s\n", pid, segment->program, now - segment->started,
+           alive ? "" : "  (process died)");
+    printf("  %-3s %-12s %-8s %14s %12s %12s %12s %10s %9s %10s\n", "#", "Label", "Status", "Iterations",
+           "Iter/s", "Current", "Best", "Temp", "Restarts", "Since best");
+
+    int running = 0, stalled = 0;
+    int threads = segment->threads < TELEMETRY_MAX_THREADS ? segment->threads : TELEMETRY_MAX_THREADS;
+    for (int t = 0; t < threads; t++) {
+        TelemetrySlot slot;
+        int consistent = telemetry_read(segment, t, &slot);
+        const char *status = slot.status == TELEMETRY_RUNNING ? "running" : slot.status == TELEMETRY_DONE ? "done" : "idle";
+        if (!consistent) {
+            // Shown as-is: a dead writer never finishes its update, a live one is mid-write
+            printf("  %-3d %-12.12s %-8s %14lld %12s %12lld %12lld %10.3g %9lld %10s\n", t, slot.label,
+                   alive ? "busy" : "stale", (long long)slot.iterations, "-", (long long)slot.current_error,
+                   (long long)slot.best_error, slot.temperature, (long long)slot.restarts, "-");
+            continue;
+        }
+        double since_best = slot.best_error >= 0 ? now - slot.improved : 0;
+        if (slot.status == TELEMETRY_RUNNING) {
+            running++;
+            if (since_best > stall_seconds) {
+                stalled++;
+                status = "stalled";
+            }
+        }
+        printf("  %-3d %-12.12s %-8s %14lld %12.0f %12lld %12lld %10.3g %9lld %9.0fs\n", t, slot.label, status,
+               (long long)slot.iterations, thread_rate(pid, t, &slot, segment->started), (long long)slot.current_error,
+               (long long)slot.best_error, slot.temperature, (long long)slot.restarts, since_best);
+    }
+
+    // A run is stalled when none of its running threads found a new best for stall_seconds
+    if (alive && running > 0 && stalled == running) {
+        printf("  Stalled: no new best for %.0f s", stall_seconds);
+        if (kill_stalled && kill(pid, SIGTERM) == 0) {
+            printf(", SIGTERM sent");
+        }
+        printf("\n");
+    }
+    if (!alive && clean) {
+        shm_unlink(path);
+        printf("  Segment removed\n");
+    }
+    printf("\n");
+    munmap(segment, sizeof(TelemetrySegment));
+    return 1;
+}
+
+// Print every segment (or the one of only_pid), returns how many were shown
+int show_all(int only_pid, double stall_seconds, int kill_stalled, int clean) {
+    int shown = 0;
+
+    if (only_pid) {
+        char name[64];
+        snprintf(name, sizeof(name), TELEMETRY_PREFIX "%d", only_pid);
+        return show_segment(name, stall_seconds, kill_stalled, clean);
+    }
+
+    DIR *directory = opendir(SHM_DIRECTORY);
+    if (directory == NULL) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL) {
+        if (strncmp(entry->d_name, TELEMETRY_PREFIX, strlen(TELEMETRY_PREFIX)) == 0) {
+            shown += show_segment(entry->d_name, stall_seconds, kill_stalled, clean);
+        }
+    }
+    closedir(directory);
+    return shown;
+}
@@ -0,0 +1,381 @@
+// Append-only, memory-mapped archive of solved cubes and local optima
+//
+// Include after defining N, TOTAL_NUMBERS and CANONICAL_PLANE_DIAGONALS. The archive file holds
+// a small header followed by fixed-size records, the sidecar "<file>.idx" holds an open-addressing
+// hash table keyed by canonical hash so membership tests are O(1). The index is only a
+// cache: it is rebuilt from the records whenever it is missing or out of date, which it
+// notices from the size of the record file and the hash of the last record it indexed.
+// Appends take an exclusive flock() so several solver processes can share one archive.
+// The header records the line set (plane diagonals) the errors and canonical hashes were
+// computed with; an archive written with another line set is rejected, since its errors
+// cannot be ranked against ours and its hashes come from another symmetry group.
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "canonical.h"
+
+#define ARCHIVE_MAGIC "CUBEARC2"
+#define ARCHIVE_INDEX_MAGIC "CUBEIDX3"
+#define ARCHIVE_INITIAL_CAPACITY 256
+#define ARCHIVE_INDEX_INITIAL_SLOTS 1024
+
+typedef struct {
+    unsigned long long hash;        // Canonical hash of the cube
+    long long timestamp;            // Time the record was stored
+    int error;                      // Final error reported by the solver
+    unsigned int seed;              // Seed passed to srand()
+    char algorithm[16];             // Name of the solver
+    char parameters[48];            // Solver parameters as "key=value" pairs
+    unsigned short cells[TOTAL_NUMBERS];
+} ArchiveRecord;
+
+typedef struct {
+    char magic[8];
+    int n;
+    int plane_diagonals;            // CANONICAL_PLANE_DIAGONALS of the solvers writing the archive
+    int record_size;
+    long long count;                // Number of records written
+    long long capacity;             // Number of records the file can hold
+} ArchiveHeader;
+
+typedef struct {
+    char magic[8];
+    long long indexed;              // Number of records already in the table
+    long long slots;                // Table size, always a power of two
+    long long archive_size;         // Size of the record file when the table was last synced
+    unsigned long long last_hash;   // Hash of record indexed - 1, to tell a replaced archive apart
+} ArchiveIndexHeader;
+
+typedef struct {
+    int fd;
+    int index_fd;
+    ArchiveHeader *header;
+    ArchiveRecord *records;
+    size_t mapped_size;
+    ArchiveIndexHeader *index;
+    long long *slots;               // Record number + 1, or 0 when empty
+    size_t index_mapped_size;
+} Archive;
+
+// Map the record file with room for its current capacity
+static inline int archive_map(Archive *archive) {
+    struct stat st;
+    if (fstat(archive->fd, &st) != 0) {
+        return 0;
+    }
+    if (archive->header != NULL) {
+        munmap(archive->header, archive->mapped_size);
+    }
+    archive->mapped_size = (size_t)st.st_size;
+    archive->header = mmap(NULL, archive->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, archive->fd, 0);
+    if (archive->header == MAP_FAILED) {
+        archive->header = NULL;
+        return 0;
+    }
+    archive->records = (ArchiveRecord *)(archive->header + 1);
+    return 1;
+}
+
+// Map the index file
+static inline int archive_map_index(Archive *archive) {
+    struct stat st;
+    if (fstat(archive->index_fd, &st) != 0) {
+        return 0;
+    }
+    if (archive->index != NULL) {
+        munmap(archive->index, archive->index_mapped_size);
+    }
+    archive->index_mapped_size = (size_t)st.st_size;
+    archive->index = mmap(NULL, archive->index_mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, archive->index_fd, 0);
+    if (archive->index == MAP_FAILED) {
+        archive->index = NULL;
+        return 0;
+    }
+    archive->slots = (long long *)(archive->index + 1);
+    return 1;
+}
+
+// Insert a record into the hash table, replacing an older record of the same cube
+static inline void archive_index_insert(Archive *archive, long long record) {
+    unsigned long long mask = (unsigned long long)archive->index->slots - 1;
+    unsigned long long slot = archive->records[record].hash & mask;
+
+    while (archive->slots[slot] != 0) {
+        if (archive->records[archive->slots[slot] - 1].hash == archive->records[record].hash) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    archive->slots[slot] = record + 1;
+}
+
+// Bring the index up to date with the records, growing it when it gets half full
+static inline int archive_sync_index(Archive *archive) {
+    long long count = archive->header->count;
+    long long slots = archive->index->slots;
+
+    if (count * 2 > slots) {
+        while (count * 2 > slots) {
+            slots *= 2;
+        }
+        if (ftruncate(archive->index_fd, (off_t)(sizeof(ArchiveIndexHeader) + slots * sizeof(long long))) != 0) {
+            return 0;
+        }
+        if (!archive_map_index(archive)) {
+            return 0;
+        }
+        memset(archive->slots, 0, slots * sizeof(long long));
+        archive->index->slots = slots;
+        archive->index->indexed = 0;
+    }
+
+    for (long long r = archive->index->indexed; r < count; r++) {
+        archive_index_insert(archive, r);
+    }
+    archive->index->indexed = count;
+    archive->index->archive_size = (long long)archive->mapped_size;
+    archive->index->last_hash = count > 0 ? archive->records[count - 1].hash : 0;
+    return 1;
+}
+
+// Check that the table was built from these records, every append updates it under the lock
+static inline int archive_index_current(Archive *archive) {
+    long long indexed = archive->index->indexed;
+    if (indexed > archive->header->count || archive->index->archive_size != (long long)archive->mapped_size) {
+        return 0;
+    }
+    return indexed == 0 || archive->records[indexed - 1].hash == archive->index->last_hash;
+}
+
+// Open (or create) an archive, returns 0 on failure
+static inline int archive_open(Archive *archive, const char *path) {
+    char index_path[512];
+
+    memset(archive, 0, sizeof(Archive));
+    archive->fd = open(path, O_RDWR | O_CREAT, 0644);
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    archive->index_fd = open(index_path, O_RDWR | O_CREAT, 0644);
+    if (archive->fd < 0 || archive->index_fd < 0) {
+        printf("Error opening archive '%s'!\n", path);
+        return 0;
+    }
+
+    flock(archive->fd, LOCK_EX);
+
+    // Initialize an empty archive
+    struct stat st;
+    if (fstat(archive->fd, &st) != 0) {
+        flock(archive->fd, LOCK_UN);
+        return 0;
+    }
+    if (st.st_size == 0) {
+        ArchiveHeader header = {ARCHIVE_MAGIC, N, CANONICAL_PLANE_DIAGONALS, (int)sizeof(ArchiveRecord), 0,
+                                ARCHIVE_INITIAL_CAPACITY};
+        if (ftruncate(archive->fd, (off_t)(sizeof(ArchiveHeader) + ARCHIVE_INITIAL_CAPACITY * sizeof(ArchiveRecord))) != 0
+            || pwrite(archive->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            flock(archive->fd, LOCK_UN);
+            return 0;
+        }
+    }
+    if (fstat(archive->index_fd, &st) != 0) {
+        flock(archive->fd, LOCK_UN);
+        return 0;
+    }
+    char index_magic[8];
+    if (st.st_size < (off_t)sizeof(ArchiveIndexHeader) || pread(archive->index_fd, index_magic, 8, 0) != 8
+        || memcmp(index_magic, ARCHIVE_INDEX_MAGIC, 8) != 0) {
+        // Missing or written by an older format, start an empty table
+        ArchiveIndexHeader header = {ARCHIVE_INDEX_MAGIC, 0, ARCHIVE_INDEX_INITIAL_SLOTS, 0, 0};
+        if (ftruncate(archive->index_fd, 0) != 0
+            || ftruncate(archive->index_fd, (off_t)(sizeof(header) + ARCHIVE_INDEX_INITIAL_SLOTS * sizeof(long long))) != 0
+            || pwrite(archive->index_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            flock(archive->fd, LOCK_UN);
+            return 0;
+        }
+    }
+
+    int ok = archive_map(archive) && archive_map_index(archive);
+    if (ok && (memcmp(archive->header->magic, ARCHIVE_MAGIC, 8) != 0 || archive->header->n != N
+               || archive->header->record_size != (int)sizeof(ArchiveRecord))) {
+        printf("Archive '%s' was written for a different cube size or format!\n", path);
+        ok = 0;
+    }
+    if (ok && archive->header->plane_diagonals != CANONICAL_PLANE_DIAGONALS) {
+        printf("Archive '%s' holds cubes scored with %d plane diagonal families, this solver uses %d!\n", path,
+               archive->header->plane_diagonals, CANONICAL_PLANE_DIAGONALS);
+        ok = 0;
+    }
+    if (ok && !archive_index_current(archive)) {
+        archive->index->indexed = 0;  // Stale index of a replaced or rewritten archive, rebuild it
+        memset(archive->slots, 0, archive->index->slots * sizeof(long long));
+    }
+    ok = ok && archive_sync_index(archive);
+
+    flock(archive->fd, LOCK_UN);
+    return ok;
+}
+
+// Release the mappings and file descriptors
+static inline void archive_close(Archive *archive) {
+    if (archive->header != NULL) munmap(archive->header, archive->mapped_size);
+    if (archive->index != NULL) munmap(archive->index, archive->index_mapped_size);
+    if (archive->fd >= 0) close(archive->fd);
+    if (archive->index_fd >= 0) close(archive->index_fd);
+    memset(archive, 0, sizeof(Archive));
+}
+
+// Pick up records appended by other processes since the last call
+static inline int archive_refresh(Archive *archive) {
+    struct stat st;
+    if (fstat(archive->fd, &st) == 0 && (size_t)st.st_size != archive->mapped_size && !archive_map(archive)) {
+        return 0;
+    }
+    if (fstat(archive->index_fd, &st) == 0 && (size_t)st.st_size != archive->index_mapped_size
+        && !archive_map_index(archive)) {
+        return 0;
+    }
+    return archive_sync_index(archive);
+}
+
+// Find the record of a canonical hash, returns -1 if the cube is not archived
+static inline long long archive_find(Archive *archive, unsigned long long hash) {
+    unsigned long long mask = (unsigned long long)archive->index->slots - 1;
+    unsigned long long slot = hash & mask;
+
+    while (archive->slots[slot] != 0) {
+        long long record = archive->slots[slot] - 1;
+        if (archive->records[record].hash == hash) {
+            return record;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+// Check if a cube (or any cube of its symmetry class) is in the archive
+static inline int archive_contains(Archive *archive, int cube[N][N][N]) {
+    return archive_find(archive, canonical_hash(cube)) >= 0;
+}
+
+// Append a cube, returns 1 if it was stored and 0 if an equal or better copy exists
+static inline int archive_store(Archive *archive, int cube[N][N][N], int error, const char *algorithm,
+                         const char *parameters, unsigned int seed) {
+    unsigned long long hash = canonical_hash(cube);
+    const int *cells = &cube[0][0][0];
+    int stored = 0;
+
+    flock(archive->fd, LOCK_EX);
+    if (!archive_refresh(archive)) {
+        flock(archive->fd, LOCK_UN);
+        return 0;
+    }
+
+    long long existing = archive_find(archive, hash);
+    if (existing < 0 || archive->records[existing].error > error) {
+        // Grow the file by doubling its capacity
+        if (archive->header->count == archive->header->capacity) {
+            long long capacity = archive->header->capacity * 2;
+            if (ftruncate(archive->fd, (off_t)(sizeof(ArchiveHeader) + capacity * sizeof(ArchiveRecord))) != 0
+                || !archive_map(archive)) {
+                flock(archive->fd, LOCK_UN);
+                return 0;
+            }
+            archive->header->capacity = capacity;
+        }
+
+        ArchiveRecord *record = &archive->records[archive->header->count];
+        memset(record, 0, sizeof(ArchiveRecord));
+        record->hash = hash;
+        record->timestamp = (long long)time(NULL);
+        record->error = error;
+        record->seed = seed;
+        snprintf(record->algorithm, sizeof(record->algorithm), "%s", algorithm);
+        snprintf(record->parameters, sizeof(record->parameters), "%s", parameters);
+        for (int x = 0; x < TOTAL_NUMBERS; x++) {
+            record->cells[x] = (unsigned short)cells[x];
+        }
+
+        archive->header->count++;
+        archive_sync_index(archive);
+        stored = 1;
+    }
+
+    flock(archive->fd, LOCK_UN);
+    return stored;
+}
+
+// Record numbers of the k records with the lowest error, best first; returns how many
+static inline int archive_top_k(Archive *archive, long long result[], int k) {
+    int found = 0;
+    if (k <= 0) {
+        return 0;
+    }
+
+    // Bounded insertion into a sorted array of size k, one pass over the records
+    for (long long r = 0; r < archive->header->count; r++) {
+        int error = archive->records[r].error;
+        if (archive_find(archive, archive->records[r].hash) != r) {
+            continue;  // Superseded by a better copy of the same cube
+        }
+        if (found == k && error >= archive->records[result[k - 1]].error) {
+            continue;
+        }
+        int pos = found < k ? found++ : k - 1;
+        while (pos > 0 && archive->records[result[pos - 1]].error > error) {
+            result[pos] = result[pos - 1];
+            pos--;
+        }
+        result[pos] = r;
+    }
+    return found;
+}
+
+// Copy an archived record into a cube
+static inline void archive_load(Archive *archive, long long record, int cube[N][N][N]) {
+    int *cells = &cube[0][0][0];
+    for (int x = 0; x < TOTAL_NUMBERS; x++) {
+        cells[x] = archive->records[record].cells[x];
+    }
+}
+
+// Start from a random one of the k best archived cubes, returns 0 if the archive is empty
+static inline int archive_warm_start(const char *path, int k, int cube[N][N][N]) {
+    Archive archive;
+    long long *best = malloc(sizeof(long long) * k);
+    int found = 0;
+
+    if (archive_open(&archive, path)) {
+        found = archive_top_k(&archive, best, k);
+        if (found > 0) {
+            archive_load(&archive, best[rand() % found], cube);
+        }
+    }
+    archive_close(&archive);
+    free(best);
+    return found > 0;
+}
+
+// Store a result in the archive file, opening and closing it around the append
+static inline int archive_save(const char *path, int cube[N][N][N], int error, const char *algorithm,
+                        const char *parameters, unsigned int seed) {
+    Archive archive;
+    int stored = 0;
+
+    if (archive_open(&archive, path)) {
+        stored = archive_store(&archive, cube, error, algorithm, parameters, seed);
+    }
+    archive_close(&archive);
+    return stored;
+}
+
+#endif
@@ -0,0 +1,120 @@
+// Arena memory for search state: one mmap'd region per thread, handed out with a bump pointer
+//
+// Nothing is freed piece by piece, a worker resets its arena between jobs. Pages can be backed
+// by transparent huge pages (madvise) or explicit huge pages (MAP_HUGETLB, falls back to normal
+// pages when none are reserved). Linux places a page on the NUMA node of the thread that first
+// writes it, so each thread should touch the pages it will work on first (arena_first_touch)
+// instead of letting one thread initialise everything. With huge pages that placement is per
+// 2 MiB, so data smaller than one page always lands on a single node. The capacity is the memory cap of the arena and
+// peak records the most it ever held, so memory use can be reported per job.
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define ARENA_PAGES_NORMAL 0       // Regular 4 KiB pages
+#define ARENA_PAGES_TRANSPARENT 1  // Ask the kernel for transparent huge pages
+#define ARENA_PAGES_EXPLICIT 2     // Explicit huge pages from the hugetlbfs pool
+#define ARENA_ALIGN 64             // Every allocation starts on its own cache line
+#define ARENA_HUGE_PAGE (2UL << 20)
+
+typedef struct {
+    char *base;
+    size_t capacity;    // Bytes reserved, allocations beyond it fail
+    size_t used;
+    size_t peak;
+    int pages;          // Page kind actually obtained
+} Arena;
+
+// Reserve capacity bytes of address space, physical pages are only taken when touched
+static inline int arena_create(Arena *arena, size_t capacity, int pages) {
+    memset(arena, 0, sizeof(Arena));
+    capacity = (capacity + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE;
+
+    void *base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (pages == ARENA_PAGES_EXPLICIT) {
+        base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (base == MAP_FAILED) {
+        pages = pages == ARENA_PAGES_NORMAL ? ARENA_PAGES_NORMAL : ARENA_PAGES_TRANSPARENT;
+        base = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    }
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+#ifdef MADV_HUGEPAGE
+    if (pages == ARENA_PAGES_TRANSPARENT && madvise(base, capacity, MADV_HUGEPAGE) != 0) {
+        pages = ARENA_PAGES_NORMAL;
+    }
+#endif
+
+    arena->base = base;
+    arena->capacity = capacity;
+    arena->pages = pages;
+    return 1;
+}
+
+// Allocate size zero-initialised bytes, returns NULL when the arena is full
+static inline void *arena_alloc(Arena *arena, size_t size) {
+    size_t start = (arena->used + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+    if (arena->base == NULL || start + size > arena->capacity) {
+        return NULL;
+    }
+    arena->used = start + size;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+    return arena->base + start;
+}
+
+// Allocate count elements of size bytes, like calloc
+static inline void *arena_calloc(Arena *arena, size_t count, size_t size) {
+    void *memory = arena_alloc(arena, count * size);
+    if (memory != NULL) {
+        memset(memory, 0, count * size);
+    }
+    return memory;
+}
+
+// Size of the pages backing the arena, the unit the kernel places on a NUMA node
+static inline size_t arena_page_size(const Arena *arena) {
+    return arena->pages == ARENA_PAGES_NORMAL ? (size_t)sysconf(_SC_PAGESIZE) : ARENA_HUGE_PAGE;
+}
+
+// Touch the pages of an array of count elements that start in an element owned by thread, so
+// every page is placed on the node of the thread that owns its first element. Every thread of
+// the team calls it with the same owner[] table, and each page is touched by exactly one of them
+static inline void arena_first_touch(const Arena *arena, void *memory, size_t element_size, int count,
+                                     const int owner[], int thread) {
+    size_t page = arena_page_size(arena);
+    uintptr_t start = (uintptr_t)memory, end = start + element_size * count;
+
+    for (uintptr_t address = start / page * page; address < end; address += page) {
+        uintptr_t first = address < start ? start : address;
+        if (owner[(first - start) / element_size] == thread) {
+            *(volatile char *)first = 0;
+        }
+    }
+}
+
+// Forget every allocation, the pages stay mapped (and placed) for the next job
+static inline void arena_reset(Arena *arena) {
+    arena->used = 0;
+}
+
+// Unmap the whole arena
+static inline void arena_destroy(Arena *arena) {
+    if (arena->base != NULL) {
+        munmap(arena->base, arena->capacity);
+    }
+    memset(arena, 0, sizeof(Arena));
+}
+
+#endif
@@ -0,0 +1,147 @@
+// Canonical form of a cube under the symmetries of the objective function
+//
+// Include after defining N and TOTAL_NUMBERS. CANONICAL_PLANE_DIAGONALS selects the
+// lines of the objective (0: none, 1: x-y slices like Restart.c, 2: all slices like
+// Annealing.c and Genetic.c). Only the rotations and reflections that map that set of
+// lines onto itself are used, so two cubes with the same canonical form always have the
+// same error. The complement map v -> TOTAL_NUMBERS + 1 - v is always included.
+// The tables are built on first use; a program hashing from several threads calls
+// canonical_init() once before starting them.
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include <string.h>
+
+#ifndef CANONICAL_PLANE_DIAGONALS
+#define CANONICAL_PLANE_DIAGONALS 2
+#endif
+
+#define CANONICAL_MAX_LINES (3 * N * N + 2 + 6 * N)
+
+// canonical_perm[g][x] is the cell of the original cube that lands on cell x
+static int canonical_perm[48][TOTAL_NUMBERS];
+static int canonical_count = 0;
+
+// Mark the cells of a line in a bitmap given its first cell and step
+static void canonical_line(unsigned char lines[][TOTAL_NUMBERS], int *num_lines,
+                           int i, int j, int k, int di, int dj, int dk) {
+    memset(lines[*num_lines], 0, TOTAL_NUMBERS);
+    for (int s = 0; s < N; s++) {
+        lines[*num_lines][(i + s * di) * N * N + (j + s * dj) * N + (k + s * dk)] = 1;
+    }
+    (*num_lines)++;
+}
+
+// Build the permutation tables of the symmetries that preserve the objective. The count is
+// published last, so a reader never sees a table that is still being filled
+static void canonical_init(void) {
+    static const int axes[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+    static unsigned char lines[CANONICAL_MAX_LINES][TOTAL_NUMBERS];
+    int num_lines = 0, count = 0;
+
+    if (__atomic_load_n(&canonical_count, __ATOMIC_ACQUIRE) > 0) {
+        return;
+    }
+
+    // Rows, columns and pillars are preserved by every symmetry, only diagonals matter
+    canonical_line(lines, &num_lines, 0, 0, 0, 1, 1, 1);
+    canonical_line(lines, &num_lines, 0, 0, N - 1, 1, 1, -1);
+    for (int s = 0; s < N && CANONICAL_PLANE_DIAGONALS >= 1; s++) {
+        canonical_line(lines, &num_lines, s, 0, 0, 0, 1, 1);
+        canonical_line(lines, &num_lines, s, 0, N - 1, 0, 1, -1);
+    }
+    for (int s = 0; s < N && CANONICAL_PLANE_DIAGONALS >= 2; s++) {
+        canonical_line(lines, &num_lines, 0, s, 0, 1, 0, 1);
+        canonical_line(lines, &num_lines, N - 1, s, 0, -1, 0, 1);
+        canonical_line(lines, &num_lines, 0, 0, s, 1, 1, 0);
+        canonical_line(lines, &num_lines, 0, N - 1, s, 1, -1, 0);
+    }
+
+    for (int a = 0; a < 6; a++) {
+        for (int flips = 0; flips < 8; flips++) {
+            int *perm = canonical_perm[count];
+            int image_of[TOTAL_NUMBERS];
+
+            for (int c = 0; c < TOTAL_NUMBERS; c++) {
+                int coord[3] = {c / (N * N), (c / N) % N, c % N};
+                int image[3];
+                for (int d = 0; d < 3; d++) {
+                    image[d] = coord[axes[a][d]];
+                    if (flips & (1 << d)) image[d] = N - 1 - image[d];
+                }
+                image_of[c] = image[0] * N * N + image[1] * N + image[2];
+                perm[image_of[c]] = c;
+            }
+
+            // Keep the symmetry only if every diagonal is mapped onto a diagonal
+            int preserves = 1;
+            for (int l = 0; l < num_lines && preserves; l++) {
+                unsigned char mapped[TOTAL_NUMBERS] = {0};
+                for (int c = 0; c < TOTAL_NUMBERS; c++) {
+                    if (lines[l][c]) mapped[image_of[c]] = 1;
+                }
+                int found = 0;
+                for (int m = 0; m < num_lines && !found; m++) {
+                    found = memcmp(mapped, lines[m], TOTAL_NUMBERS) == 0;
+                }
+                preserves = found;
+            }
+            if (preserves) {
+                count++;
+            }
+        }
+    }
+    __atomic_store_n(&canonical_count, count, __ATOMIC_RELEASE);
+}
+
+// Map a cube to the lexicographically smallest cube of its symmetry class
+static void canonical_form(int cube[N][N][N], int out[N][N][N]) {
+    const int *cells = &cube[0][0][0];
+    int *best = &out[0][0][0];
+    int best_g = 0, best_complement = 0;
+
+    canonical_init();
+
+    // Compare every transform with the current best, stopping at the first difference
+    for (int g = 0; g < canonical_count; g++) {
+        const int *perm = canonical_perm[g];
+        for (int complement = 0; complement < 2; complement++) {
+            if (g == 0 && complement == 0) {
+                continue;
+            }
+            const int *best_perm = canonical_perm[best_g];
+            for (int x = 0; x < TOTAL_NUMBERS; x++) {
+                int value = complement ? TOTAL_NUMBERS + 1 - cells[perm[x]] : cells[perm[x]];
+                int current = best_complement ? TOTAL_NUMBERS + 1 - cells[best_perm[x]] : cells[best_perm[x]];
+                if (value != current) {
+                    if (value < current) {
+                        best_g = g;
+                        best_complement = complement;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int x = 0; x < TOTAL_NUMBERS; x++) {
+        int value = cells[canonical_perm[best_g][x]];
+        best[x] = best_complement ? TOTAL_NUMBERS + 1 - value : value;
+    }
+}
+
+// 64-bit FNV-1a hash of the canonical form, equal for all cubes of a symmetry class
+static unsigned long long canonical_hash(int cube[N][N][N]) {
+    int canonical[N][N][N];
+    const int *cells = &canonical[0][0][0];
+    unsigned long long hash = 14695981039346656037ULL;
+
+    canonical_form(cube, canonical);
+    for (int x = 0; x < TOTAL_NUMBERS; x++) {
+        hash ^= (unsigned long long)cells[x];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,466 @@
+// Cube with incremental line sums, for solvers that pick the cube order at run time
+//
+// Every line that evaluate() checks keeps its running sum, so the error change of a
+// swap only touches the lines through the two cells instead of the whole cube.
+// plane_diagonals selects the lines like in Exact.c (0: none, 1: x-y slices, 2: all).
+// Line sums and the error are 64-bit so orders up to CUBE_MAX_ORDER cannot overflow, and
+// all storage is on the heap so large cubes never touch the stack. The error is the objective
+// selected at build time (objective.h), cube_deviation() gives the absolute deviation.
+#ifndef CUBE_H
+#define CUBE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "objective.h"
+
+#define CUBE_MAX_ORDER 32
+#define CUBE_FULL_NEIGHBOURHOOD_CELLS 343   // Larger cubes (N > 7) use a sampled neighbourhood
+#define CUBE_NEIGHBOURHOOD_SAMPLES 4096     // Swaps scored per step of a sampled neighbourhood
+
+typedef struct {
+    int n;                  // Order of the cube
+    int total;              // Number of cells, n^3
+    long long magic;        // Magic number n * (n^3 + 1) / 2
+    int num_lines;          // Number of lines checked by the objective
+    int *cells;             // Cell values, index i * n * n + j * n + k
+    int *position;          // Cell holding each value, position[v] for v in 1..n^3
+    long long *line_sum;    // Running sum of every line
+    int *line_start;        // Lines of cell c are lines[line_start[c] .. line_start[c + 1])
+    int *lines;
+    int *line_cells;        // Cells of line l are line_cells[l * n .. l * n + n)
+    long long error;        // Objective over all lines, sum of |line_sum - magic| by default
+} Cube;
+
+// Small fast random number generator, one state per thread (xorshift64*)
+static inline unsigned long long cube_rand(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 2685821657736338717ULL;
+}
+
+// Random integer in [0, bound)
+static inline int cube_rand_int(unsigned long long *state, int bound) {
+    return (int)((cube_rand(state) >> 32) * (unsigned long long)bound >> 32);
+}
+
+// Random double in [0, 1)
+static inline double cube_rand_double(unsigned long long *state) {
+    return (cube_rand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Seed a generator, the state must never be zero
+static inline void cube_seed(unsigned long long *state, unsigned long long seed) {
+    *state = seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL;
+    if (*state == 0) *state = 1;
+}
+
+// Count the lines through every cell, or fill them in when lines != NULL
+static inline int cube_build_lines(int n, int plane_diagonals, int *count, int *start, int *lines,
+                                   int *line_cells) {
+    int num_lines = 0;
+    int step[3];
+
+    // Walk one line given its first cell and step
+    #define CUBE_LINE(i0, j0, k0, di, dj, dk) do { \
+        step[0] = (di); step[1] = (dj); step[2] = (dk); \
+        for (int s = 0; s < n; s++) { \
+            int c = ((i0) + s * step[0]) * n * n + ((j0) + s * step[1]) * n + ((k0) + s * step[2]); \
+            if (lines != NULL) lines[start[c] + count[c]] = num_lines; \
+            if (line_cells != NULL) line_cells[num_lines * n + s] = c; \
+            count[c]++; \
+        } \
+        num_lines++; \
+    } while (0)
+
+    for (int a = 0; a < n; a++) {
+        for (int b = 0; b < n; b++) {
+            CUBE_LINE(a, b, 0, 0, 0, 1);   // Rows
+            CUBE_LINE(0, a, b, 1, 0, 0);   // Columns
+            CUBE_LINE(a, 0, b, 0, 1, 0);   // Pillars
+        }
+    }
+    CUBE_LINE(0, 0, 0, 1, 1, 1);           // Main space diagonals
+    CUBE_LINE(0, 0, n - 1, 1, 1, -1);
+    for (int a = 0; a < n && plane_diagonals >= 1; a++) {
+        CUBE_LINE(a, 0, 0, 0, 1, 1);       // Diagonals in horizontal (x-y) slices
+        CUBE_LINE(a, 0, n - 1, 0, 1, -1);
+    }
+    for (int a = 0; a < n && plane_diagonals >= 2; a++) {
+        CUBE_LINE(0, a, 0, 1, 0, 1);       // Diagonals in vertical (y-z) slices
+        CUBE_LINE(n - 1, a, 0, -1, 0, 1);
+        CUBE_LINE(0, 0, a, 1, 1, 0);       // Diagonals in vertical (x-z) slices
+        CUBE_LINE(0, n - 1, a, 1, -1, 0);
+    }
+
+    #undef CUBE_LINE
+    return num_lines;
+}
+
+// calloc, or an arena allocation when an arena is given
+static inline void *cube_calloc(Arena *arena, size_t count, size_t size) {
+    return arena != NULL ? arena_calloc(arena, count, size) : calloc(count, size);
+}
+
+// Allocate a cube of order n from an arena (NULL: the heap), returns 0 when out of memory.
+// A cube taken from an arena is released with the arena, never with cube_free()
+static inline int cube_init_in(Cube *cube, int n, int plane_diagonals, Arena *arena) {
+    int total = n * n * n;
+    int *count = calloc(total, sizeof(int));
+
+    memset(cube, 0, sizeof(Cube));
+    if (n < 1 || n > CUBE_MAX_ORDER) {
+        free(count);
+        return 0;
+    }
+    cube->n = n;
+    cube->total = total;
+    cube->magic = (long long)n * (total + 1) / 2;
+    cube->cells = cube_calloc(arena, total, sizeof(int));
+    cube->position = cube_calloc(arena, total + 1, sizeof(int));
+    cube->line_start = cube_calloc(arena, total + 1, sizeof(int));
+    if (count == NULL || cube->cells == NULL || cube->position == NULL || cube->line_start == NULL) {
+        free(count);
+        return 0;
+    }
+
+    // First pass counts the lines per cell, the second pass fills them in
+    cube->num_lines = cube_build_lines(n, plane_diagonals, count, NULL, NULL, NULL);
+    for (int c = 0; c < total; c++) {
+        cube->line_start[c + 1] = cube->line_start[c] + count[c];
+        count[c] = 0;
+    }
+    cube->lines = cube_calloc(arena, cube->line_start[total], sizeof(int));
+    cube->line_cells = cube_calloc(arena, (size_t)cube->num_lines * n, sizeof(int));
+    cube->line_sum = cube_calloc(arena, cube->num_lines, sizeof(long long));
+    if (cube->lines == NULL || cube->line_cells == NULL || cube->line_sum == NULL) {
+        free(count);
+        return 0;
+    }
+    cube_build_lines(n, plane_diagonals, count, cube->line_start, cube->lines, cube->line_cells);
+
+    free(count);
+    return 1;
+}
+
+// Allocate a cube of order n on the heap, returns 0 when out of memory
+static inline int cube_init(Cube *cube, int n, int plane_diagonals) {
+    return cube_init_in(cube, n, plane_diagonals, NULL);
+}
+
+// Release the memory of a cube
+static inline void cube_free(Cube *cube) {
+    free(cube->cells);
+    free(cube->position);
+    free(cube->line_sum);
+    free(cube->line_cells);
+    free(cube->line_start);
+    free(cube->lines);
+    memset(cube, 0, sizeof(Cube));
+}
+
+// Recompute every line sum and the error from the cell values
+static inline long long cube_evaluate(Cube *cube) {
+    memset(cube->line_sum, 0, sizeof(long long) * cube->num_lines);
+    for (int c = 0; c < cube->total; c++) {
+        cube->position[cube->cells[c]] = c;
+        for (int l = cube->line_start[c]; l < cube->line_start[c + 1]; l++) {
+            cube->line_sum[cube->lines[l]] += cube->cells[c];
+        }
+    }
+    cube->error = 0;
+    for (int l = 0; l < cube->num_lines; l++) {
+        cube->error += objective_cost(cube->line_sum[l] - cube->magic, objective_line_class(l, cube->n));
+    }
+    return cube->error;
+}
+
+// Sum of |line_sum - magic| over all lines, whatever the objective
+static inline long long cube_deviation(const Cube *cube) {
+    long long deviation = 0;
+    for (int l = 0; l < cube->num_lines; l++) {
+        deviation += llabs(cube->line_sum[l] - cube->magic);
+    }
+    return deviation;
+}
+
+// Fill the cube with numbers from 1 to n^3 randomly
+static inline void cube_randomize(Cube *cube, unsigned long long *rng) {
+    for (int c = 0; c < cube->total; c++) {
+        cube->cells[c] = c + 1;
+    }
+    for (int c = cube->total - 1; c > 0; c--) {
+        int r = cube_rand_int(rng, c + 1);
+        int temp = cube->cells[c];
+        cube->cells[c] = cube->cells[r];
+        cube->cells[r] = temp;
+    }
+    cube_evaluate(cube);
+}
+
+// Copy the cells, line sums and error of a cube of the same order
+static inline void cube_copy(const Cube *src, Cube *dest) {
+    memcpy(dest->cells, src->cells, sizeof(int) * src->total);
+    memcpy(dest->position, src->position, sizeof(int) * (src->total + 1));
+    memcpy(dest->line_sum, src->line_sum, sizeof(long long) * src->num_lines);
+    dest->error = src->error;
+}
+
+// Error change if cells a and b were swapped, the cube is left untouched
+static inline long long cube_swap_delta(const Cube *cube, int a, int b) {
+    int diff = cube->cells[b] - cube->cells[a];
+    long long delta = 0;
+    int la = cube->line_start[a], ea = cube->line_start[a + 1];
+    int lb = cube->line_start[b], eb = cube->line_start[b + 1];
+
+    if (diff == 0) {
+        return 0;
+    }
+
+    // Both line lists are sorted, a line through both cells keeps its sum
+    while (la < ea || lb < eb) {
+        int line, change;
+        if (lb >= eb || (la < ea && cube->lines[la] < cube->lines[lb])) {
+            line = cube->lines[la++];
+            change = diff;
+        } else if (la >= ea || cube->lines[lb] < cube->lines[la]) {
+            line = cube->lines[lb++];
+            change = -diff;
+        } else {
+            la++;
+            lb++;
+            continue;
+        }
+        delta += objective_line_delta(cube->line_sum[line] - cube->magic, change, objective_line_class(line, cube->n));
+    }
+    return delta;
+}
+
+// Swap cells a and b and update the line sums and error
+static inline void cube_apply_swap(Cube *cube, int a, int b, long long delta) {
+    int diff = cube->cells[b] - cube->cells[a];
+
+    for (int l = cube->line_start[a]; l < cube->line_start[a + 1]; l++) {
+        cube->line_sum[cube->lines[l]] += diff;
+    }
+    for (int l = cube->line_start[b]; l < cube->line_start[b + 1]; l++) {
+        cube->line_sum[cube->lines[l]] -= diff;
+    }
+    int temp = cube->cells[a];
+    cube->cells[a] = cube->cells[b];
+    cube->cells[b] = temp;
+    cube->position[cube->cells[a]] = a;
+    cube->position[cube->cells[b]] = b;
+    cube->error += delta;
+}
+
+// Candidate swap aimed at a violated line: the most violated of a few sampled lines
+// gives a cell a, and b is the cell holding the value that would fix that line
+static inline void cube_candidate_swap(const Cube *cube, unsigned long long *rng, int *a, int *b) {
+    int line = cube_rand_int(rng, cube->num_lines);
+    long long deviation = cube->line_sum[line] - cube->magic;
+
+    for (int s = 1; s < 4; s++) {
+        int other = cube_rand_int(rng, cube->num_lines);
+        if (llabs(cube->line_sum[other] - cube->magic) > llabs(deviation)) {
+            line = other;
+            deviation = cube->line_sum[other] - cube->magic;
+        }
+    }
+
+    *a = cube->line_cells[line * cube->n + cube_rand_int(rng, cube->n)];
+    long long wanted = cube->cells[*a] - deviation;
+    if (wanted < 1) wanted = 1;
+    if (wanted > cube->total) wanted = cube->total;
+    *b = cube->position[wanted];
+    if (*b == *a) {
+        *b = cube_rand_int(rng, cube->total);
+    }
+}
+
+// Best of a sampled neighbourhood: half candidate swaps, half uniform random swaps
+static inline long long cube_sampled_best_swap(const Cube *cube, unsigned long long *rng, int samples,
+                                               int *best_a, int *best_b) {
+    long long best_delta = 0;
+    *best_a = -1;
+    for (int s = 0; s < samples; s++) {
+        int a, b;
+        if (s & 1) {
+            a = cube_rand_int(rng, cube->total);
+            b = cube_rand_int(rng, cube->total);
+        } else {
+            cube_candidate_swap(cube, rng, &a, &b);
+        }
+        if (a == b) continue;
+        long long delta = cube_swap_delta(cube, a, b);
+        if (delta < best_delta || (*best_a < 0 && delta == 0)) {
+            best_delta = delta;
+            *best_a = a;
+            *best_b = b;
+        }
+    }
+    return best_delta;
+}
+
+// Best swap of the neighbourhood, returns its delta (first best on ties). The full
+// neighbourhood has total^2 / 2 swaps, large cubes only score a sample of it
+static inline long long cube_best_swap(const Cube *cube, unsigned long long *rng, int *best_a, int *best_b) {
+    long long best_delta = 0;
+
+    if (cube->total > CUBE_FULL_NEIGHBOURHOOD_CELLS) {
+        return cube_sampled_best_swap(cube, rng, CUBE_NEIGHBOURHOOD_SAMPLES, best_a, best_b);
+    }
+
+    *best_a = -1;
+    for (int a = 0; a < cube->total; a++) {
+        for (int b = a + 1; b < cube->total; b++) {
+            long long delta = cube_swap_delta(cube, a, b);
+            if (delta < best_delta || (*best_a < 0 && delta == 0)) {
+                best_delta = delta;
+                *best_a = a;
+                *best_b = b;
+            }
+        }
+    }
+    return best_delta;
+}
+
+// Zobrist key of a value in a cell, mixed from the pair (splitmix64) so no table of total^2
+// keys is needed. The hash of a cube is the XOR of the keys of its cells
+static inline unsigned long long cube_zobrist(int cell, int value) {
+    unsigned long long x = ((unsigned long long)cell << 32 | (unsigned int)value) + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Zobrist hash of a whole cube
+static inline unsigned long long cube_hash(const Cube *cube) {
+    unsigned long long hash = 0;
+    for (int c = 0; c < cube->total; c++) {
+        hash ^= cube_zobrist(c, cube->cells[c]);
+    }
+    return hash;
+}
+
+// Hash of the cube after swapping cells a and b, the cube is left untouched
+static inline unsigned long long cube_swap_hash(const Cube *cube, unsigned long long hash, int a, int b) {
+    return hash ^ cube_zobrist(a, cube->cells[a]) ^ cube_zobrist(b, cube->cells[b])
+           ^ cube_zobrist(a, cube->cells[b]) ^ cube_zobrist(b, cube->cells[a]);
+}
+
+// States visited on one plateau, open addressing on their hashes, 0 marks an empty slot
+typedef struct {
+    unsigned long long *slots;
+    int capacity;           // Power of two, at least twice the states it holds
+} CubeVisited;
+
+// Allocate a visited set for up to states states, returns 0 when out of memory
+static inline int cube_visited_init(CubeVisited *visited, int states) {
+    visited->capacity = 16;
+    while (visited->capacity < 2 * (states + 1)) {
+        visited->capacity *= 2;
+    }
+    visited->slots = calloc(visited->capacity, sizeof(unsigned long long));
+    return visited->slots != NULL;
+}
+
+// Release the memory of a visited set
+static inline void cube_visited_free(CubeVisited *visited) {
+    free(visited->slots);
+    memset(visited, 0, sizeof(CubeVisited));
+}
+
+// Forget the states of the plateau that was just left
+static inline void cube_visited_clear(CubeVisited *visited) {
+    memset(visited->slots, 0, sizeof(unsigned long long) * visited->capacity);
+}
+
+// Add a state, returns 0 when it was already there or the set is full
+static inline int cube_visited_insert(CubeVisited *visited, unsigned long long hash) {
+    if (hash == 0) hash = 1;
+    for (int probe = 0; probe < visited->capacity; probe++) {
+        unsigned long long *slot = &visited->slots[(hash + probe) & (visited->capacity - 1)];
+        if (*slot == hash) return 0;
+        if (*slot == 0) {
+            *slot = hash;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 1 if the state was visited on the current plateau
+static inline int cube_visited_contains(const CubeVisited *visited, unsigned long long hash) {
+    if (hash == 0) hash = 1;
+    for (int probe = 0; probe < visited->capacity; probe++) {
+        unsigned long long slot = visited->slots[(hash + probe) & (visited->capacity - 1)];
+        if (slot == hash) return 1;
+        if (slot == 0) return 0;
+    }
+    return 0;
+}
+
+// Plateau search step, like PLATEAU_SEARCH in Sideways.c: the best delta of the neighbourhood
+// (sampled for large cubes), one of the swaps reaching it picked uniformly by reservoir
+// sampling, and equal moves into a state of visited skipped. Returns the delta, *best_a is -1
+// when every equal move leads back to a visited state
+static inline long long cube_plateau_swap(const Cube *cube, unsigned long long hash, const CubeVisited *visited,
+                                          unsigned long long *rng, int *best_a, int *best_b) {
+    int full = cube->total <= CUBE_FULL_NEIGHBOURHOOD_CELLS;
+    long long count = full ? (long long)cube->total * (cube->total - 1) / 2 : CUBE_NEIGHBOURHOOD_SAMPLES;
+    long long best_delta = 0;
+    int moves = 0, a = 0, b = 0;
+
+    *best_a = -1;
+    for (long long s = 0; s < count; s++) {
+        if (full) {
+            if (++b >= cube->total) {
+                a++;
+                b = a + 1;
+            }
+        } else if (s & 1) {
+            a = cube_rand_int(rng, cube->total);
+            b = cube_rand_int(rng, cube->total);
+        } else {
+            cube_candidate_swap(cube, rng, &a, &b);
+        }
+        if (a == b) continue;
+
+        long long delta = cube_swap_delta(cube, a, b);
+        if (delta > best_delta || (delta == 0 && cube_visited_contains(visited, cube_swap_hash(cube, hash, a, b)))) {
+            continue;
+        }
+        if (delta < best_delta) {
+            best_delta = delta;
+            moves = 0;
+        }
+        if (cube_rand_int(rng, ++moves) == 0) {
+            *best_a = a;
+            *best_b = b;
+        }
+    }
+    return best_delta;
+}
+
+// Print the cube in the same layout as print_cube()
+static inline void cube_print(const Cube *cube) {
+    int n = cube->n;
+    for (int i = 0; i < n; i++) {
+        printf("Slice %d:\n", i + 1);
+        for (int j = 0; j < n; j++) {
+            for (int k = 0; k < n; k++) {
+                printf("%3d ", cube->cells[i * n * n + j * n + k]);
+            }
+            printf("\n");
+        }
+        printf("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include <math.h>
+
+#include "cube.h"
+#include "moves.h"
+#include "cubesolver.h"
+
+#define TOURNAMENT_SIZE 5             // Default of params->tournament_size
+
+struct CubeSolver {
+    CubeSolverParams params;
+    unsigned long long rng;
+    Cube current;
+    Cube best;
+    Cube *population;               // Genetic algorithm only
+    Cube *new_population;
+    MoveScratch moves;              // Only when the move mix has more than swaps
+    CubeVisited visited;            // States of the current plateau, sideways only
+    unsigned long long hash;        // Zobrist hash of current, sideways only
+    int mixed_moves;
+    long long *trace;               // Error after each step, trace_capacity entries
+    long long trace_length;
+    double temperature;
+    long long iterations;
+    int sideways_moves;
+    int restarts;
+    int best_individual;
+    int done;
+};
+
+// Fill params with the defaults of the single-run programs for an algorithm
+void cube_solver_default_params(CubeSolverParams *params, CubeSolverAlgorithm algorithm) {
+    memset(params, 0, sizeof(CubeSolverParams));
+    params->algorithm = algorithm;
+    params->n = 5;
+    params->diagonals = 2;
+    params->seed = 1;
+    params->initial_temperature = 1000.0;
+    params->alpha = 0.999;
+    params->max_sideways = 5000;
+    params->max_restarts = 10;
+    params->population = 100;
+    params->mutation_rate = 0.05;
+    params->move_mix[0] = 1.0;
+    params->tournament_size = TOURNAMENT_SIZE;
+}
+
+// Create a solver from a random cube, returns NULL on invalid parameters or out of memory
+CubeSolver *cube_solver_create(const CubeSolverParams *params) {
+    double mix_total = 0;
+    for (int k = 0; k < CUBE_SOLVER_MOVE_KINDS; k++) {
+        if (params->move_mix[k] < 0) return NULL;
+        mix_total += params->move_mix[k];
+    }
+    if (mix_total <= 0 || params->n < 1 || params->n > CUBE_MAX_ORDER || params->algorithm < CUBE_SOLVER_STEEPEST
+        || params->algorithm > CUBE_SOLVER_GENETIC
+        || params->trace_capacity < 0
+        || (params->algorithm == CUBE_SOLVER_GENETIC && (params->population < 3 || params->tournament_size < 1))) {
+        return NULL;
+    }
+
+    CubeSolver *solver = calloc(1, sizeof(CubeSolver));
+    if (solver == NULL) {
+        return NULL;
+    }
+    solver->params = *params;
+    solver->temperature = params->initial_temperature;
+    cube_seed(&solver->rng, params->seed);
+
+    int ok = cube_init(&solver->current, params->n, params->diagonals)
+             && cube_init(&solver->best, params->n, params->diagonals);
+
+    solver->mixed_moves = mix_total > params->move_mix[0];
+    if (ok && solver->mixed_moves) {
+        ok = move_scratch_init(&solver->moves, &solver->current);
+    }
+    if (ok && params->algorithm == CUBE_SOLVER_SIDEWAYS) {
+        ok = cube_visited_init(&solver->visited, params->max_sideways > 0 ? params->max_sideways : 0);
+    }
+    if (ok && params->trace_capacity > 0) {
+        solver->trace = malloc(sizeof(long long) * params->trace_capacity);
+        ok = solver->trace != NULL;
+    }
+    if (ok && params->algorithm == CUBE_SOLVER_GENETIC) {
+        solver->population = calloc(params->population, sizeof(Cube));
+        solver->new_population = calloc(params->population, sizeof(Cube));
+        ok = solver->population != NULL && solver->new_population != NULL;
+        for (int i = 0; ok && i < params->population; i++) {
+            ok = cube_init(&solver->population[i], params->n, params->diagonals)
+                 && cube_init(&solver->new_population[i], params->n, params->diagonals);
+        }
+    }
+    if (!ok) {
+        cube_solver_destroy(solver);
+        return NULL;
+    }
+
+    // Initial state
+    if (params->algorithm == CUBE_SOLVER_GENETIC) {
+        for (int i = 0; i < params->population; i++) {
+            cube_randomize(&solver->population[i], &solver->rng);
+            if (solver->population[i].error < solver->population[solver->best_individual].error) {
+                solver->best_individual = i;
+            }
+        }
+        cube_copy(&solver->population[solver->best_individual], &solver->current);
+    } else {
+        cube_randomize(&solver->current, &solver->rng);
+    }
+    if (params->algorithm == CUBE_SOLVER_SIDEWAYS) {
+        solver->hash = cube_hash(&solver->current);
+        cube_visited_insert(&solver->visited, solver->hash);
+    }
+    cube_copy(&solver->current, &solver->best);
+    solver->done = solver->best.error == 0;
+    return solver;
+}
+
+// One step of steepest ascent, sideways moves or random restart. Sideways moves are a plateau
+// search: a random equal move into a state not visited since the last improvement
+static void step_steepest(CubeSolver *solver) {
+    Cube *current = &solver->current;
+    int sideways = solver->params.algorithm == CUBE_SOLVER_SIDEWAYS;
+    int a = -1, b = -1;
+    long long delta = sideways ? cube_plateau_swap(current, solver->hash, &solver->visited, &solver->rng, &a, &b)
+                               : cube_best_swap(current, &solver->rng, &a, &b);
+
+    if (delta < 0 || (sideways && a >= 0 && solver->sideways_moves < solver->params.max_sideways)) {
+        if (sideways) {
+            solver->hash = cube_swap_hash(current, solver->hash, a, b);
+            if (delta < 0) cube_visited_clear(&solver->visited);
+            cube_visited_insert(&solver->visited, solver->hash);
+        }
+        cube_apply_swap(current, a, b, delta);
+        solver->sideways_moves = delta < 0 ? 0 : solver->sideways_moves + 1;
+    } else if (solver->params.algorithm == CUBE_SOLVER_RESTART && solver->restarts < solver->params.max_restarts) {
+        solver->restarts++;
+        cube_randomize(current, &solver->rng);
+    } else {
+        solver->done = 1;
+    }
+}
+
+// One random move, accepted if it improves (stochastic) or by the Metropolis rule (annealing).
+// With a move mix the move kind is drawn from it, otherwise the move is a swap
+static void step_random(CubeSolver *solver) {
+    Cube *current = &solver->current;
+    CubeMove move = 0;
+    long long delta;
+    int a = 0, b = 0;
+
+    if (solver->mixed_moves) {
+        move = move_random(current, &solver->rng, solver->params.move_mix);
+        delta = move_delta(current, &solver->moves, move);
+    } else {
+        a = cube_rand_int(&solver->rng, current->total);
+        b = cube_rand_int(&solver->rng, current->total);
+        if (solver->params.algorithm == CUBE_SOLVER_STOCHASTIC && current->total > CUBE_FULL_NEIGHBOURHOOD_CELLS
+            && (solver->iterations & 1)) {
+            cube_candidate_swap(current, &solver->rng, &a, &b);
+        }
+        delta = cube_swap_delta(current, a, b);
+    }
+
+    if (delta < 0 || (solver->params.algorithm == CUBE_SOLVER_ANNEALING && solver->temperature > 0
+                      && exp(-(double)delta / solver->temperature) > cube_rand_double(&solver->rng))) {
+        if (solver->mixed_moves) {
+            move_apply(current, &solver->moves, move, delta);
+        } else {
+            cube_apply_swap(current, a, b, delta);
+        }
+    }
+
+    if (solver->params.algorithm == CUBE_SOLVER_ANNEALING) {
+        solver->temperature *= solver->params.alpha;
+        if (solver->temperature <= 0) {
+            solver->done = 1;
+        }
+    }
+}
+
+// Tournament selection over tournament_size random individuals
+static int tournament(CubeSolver *solver) {
+    int size = solver->params.population;
+    int best = cube_rand_int(&solver->rng, size);
+    for (int i = 1; i < solver->params.tournament_size; i++) {
+        int competitor = cube_rand_int(&solver->rng, size);
+        if (solver->population[competitor].error < solver->population[best].error) {
+            best = competitor;
+        }
+    }
+    return best;
+}
+
+// One generation: two elite copies, then mutated copies of tournament winners. Unlike Genetic.c
+// there is no crossover and the mutation rate is fixed, each child is one parent plus random swaps
+static void step_genetic(CubeSolver *solver) {
+    int size = solver->params.population;
+    int mutations = (int)(solver->current.total * solver->params.mutation_rate);
+
+    cube_copy(&solver->population[solver->best_individual], &solver->new_population[0]);
+    cube_copy(&solver->population[solver->best_individual], &solver->new_population[1]);
+    for (int i = 2; i < size; i++) {
+        Cube *child = &solver->new_population[i];
+        cube_copy(&solver->population[tournament(solver)], child);
+        for (int m = 0; m < mutations; m++) {
+            int a = cube_rand_int(&solver->rng, child->total), b = cube_rand_int(&solver->rng, child->total);
+            cube_apply_swap(child, a, b, cube_swap_delta(child, a, b));
+        }
+    }
+
+    Cube *temp = solver->population;
+    solver->population = solver->new_population;
+    solver->new_population = temp;
+
+    solver->best_individual = 0;
+    for (int i = 1; i < size; i++) {
+        if (solver->population[i].error < solver->population[solver->best_individual].error) {
+            solver->best_individual = i;
+        }
+    }
+    cube_copy(&solver->population[solver->best_individual], &solver->current);
+}
+
+// Run up to iterations steps, returns the number done (less when the solver finished)
+long long cube_solver_step(CubeSolver *solver, long long iterations) {
+    long long done = 0;
+
+    while (done < iterations && !solver->done) {
+        switch (solver->params.algorithm) {
+            case CUBE_SOLVER_STEEPEST:
+            case CUBE_SOLVER_SIDEWAYS:
+            case CUBE_SOLVER_RESTART:
+                step_steepest(solver);
+                break;
+            case CUBE_SOLVER_STOCHASTIC:
+            case CUBE_SOLVER_ANNEALING:
+                step_random(solver);
+                break;
+            case CUBE_SOLVER_GENETIC:
+                step_genetic(solver);
+                break;
+        }
+        if (solver->done) {
+            break;
+        }
+        done++;
+        solver->iterations++;
+        if (solver->trace_length < solver->params.trace_capacity) {
+            solver->trace[solver->trace_length++] = solver->current.error;
+        }
+
+        if (solver->current.error < solver->best.error) {
+            cube_copy(&solver->current, &solver->best);
+        }
+        if (solver->best.error == 0) {
+            solver->done = 1;
+        }
+    }
+    return done;
+}
+
+// Continue the search from a given cube
+int cube_solver_set_cube(CubeSolver *solver, const int *cells) {
+    Cube *current = &solver->current;
+
+    if (solver->params.algorithm == CUBE_SOLVER_GENETIC) {
+        return 0;
+    }
+    memset(current->position, 0, sizeof(int) * (current->total + 1));
+    for (int c = 0; c < current->total; c++) {
+        if (cells[c] < 1 || cells[c] > current->total || current->position[cells[c]] != 0) {
+            cube_evaluate(current);  // Rebuild the positions of the unchanged cube
+            return 0;
+        }
+        current->position[cells[c]] = c + 1;
+    }
+    memcpy(current->cells, cells, sizeof(int) * current->total);
+    cube_evaluate(current);
+
+    solver->temperature = solver->params.initial_temperature;
+    solver->sideways_moves = 0;
+    if (solver->params.algorithm == CUBE_SOLVER_SIDEWAYS) {
+        solver->hash = cube_hash(current);
+        cube_visited_clear(&solver->visited);
+        cube_visited_insert(&solver->visited, solver->hash);
+    }
+    cube_copy(current, &solver->best);
+    solver->done = solver->best.error == 0;
+    return 1;
+}
+
+// Individual of a genetic solver's current population
+const int *cube_solver_individual(const CubeSolver *solver, int index, long long *error) {
+    if (solver->params.algorithm != CUBE_SOLVER_GENETIC || index < 0 || index >= solver->params.population) {
+        return NULL;
+    }
+    if (error != NULL) {
+        *error = solver->population[index].error;
+    }
+    return solver->population[index].cells;
+}
+
+// Best cube found so far
+const int *cube_solver_best(const CubeSolver *solver) {
+    return solver->best.cells;
+}
+
+// Error of the best cube found so far
+long long cube_solver_error(const CubeSolver *solver) {
+    return solver->best.error;
+}
+
+// Sum of |line sum - magic number| of the best cube
+long long cube_solver_deviation(const CubeSolver *solver) {
+    return cube_deviation(&solver->best);
+}
+
+// Error of the cube the search is currently at
+long long cube_solver_current_error(const CubeSolver *solver) {
+    return solver->current.error;
+}
+
+// Current error after every recorded step
+const long long *cube_solver_trace(const CubeSolver *solver, long long *length) {
+    *length = solver->trace_length;
+    return solver->trace;
+}
+
+// Steps done so far
+long long cube_solver_iterations(const CubeSolver *solver) {
+    return solver->iterations;
+}
+
+// Number of restarts done
+int cube_solver_restarts(const CubeSolver *solver) {
+    return solver->restarts;
+}
+
+// 1 once the solver cannot make progress any more
+int cube_solver_done(const CubeSolver *solver) {
+    return solver->done;
+}
+
+// Release every resource of a solver
+void cube_solver_destroy(CubeSolver *solver) {
+    if (solver == NULL) {
+        return;
+    }
+    if (solver->current.cells != NULL) cube_free(&solver->current);
+    if (solver->best.cells != NULL) cube_free(&solver->best);
+    for (int i = 0; i < solver->params.population && solver->population != NULL; i++) {
+        cube_free(&solver->population[i]);
+    }
+    for (int i = 0; i < solver->params.population && solver->new_population != NULL; i++) {
+        cube_free(&solver->new_population[i]);
+    }
+    free(solver->population);
+    free(solver->new_population);
+    if (solver->mixed_moves) move_scratch_free(&solver->moves);
+    if (solver->visited.slots != NULL) cube_visited_free(&solver->visited);
+    free(solver->trace);
+    free(solver);
+}
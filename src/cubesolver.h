@@ -0,0 +1,98 @@
+// Embeddable magic cube solver API
+//
+// Every solver lives behind an opaque handle: all memory is allocated by
+// cube_solver_create(), nothing is allocated afterwards and there is no global state,
+// so any number of handles can be stepped concurrently (one thread per handle at a time).
+// A host interleaves solves by calling cube_solver_step() with small iteration counts.
+//
+// Static library:  gcc -O2 -c cubesolver.c && ar rcs libcubesolver.a cubesolver.o
+// Shared library:  gcc -O2 -fPIC -shared -o libcubesolver.so cubesolver.c -lm
+#ifndef CUBESOLVER_H
+#define CUBESOLVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CUBE_SOLVER_STEEPEST = 0,       // Steepest ascent, stops at the first local optimum
+    CUBE_SOLVER_STOCHASTIC = 1,     // Random swap accepted only if it improves
+    CUBE_SOLVER_SIDEWAYS = 2,       // Steepest ascent with up to max_sideways equal moves, each a random
+                                    // one into a state not visited on the plateau (Sideways.c PLATEAU_SEARCH)
+    CUBE_SOLVER_RESTART = 3,        // Steepest ascent with up to max_restarts random restarts
+    CUBE_SOLVER_ANNEALING = 4,      // Simulated annealing with geometric cooling
+    CUBE_SOLVER_GENETIC = 5         // Tournament selection plus swap mutation, one step is one generation.
+                                    // Not the Genetic.c GA: no line/slice crossover, no adaptive mutation
+} CubeSolverAlgorithm;
+
+#define CUBE_SOLVER_MOVE_KINDS 5    // Swap, 3-cycle, line rotation, parallel line swap, slice swap (moves.h)
+
+typedef struct {
+    CubeSolverAlgorithm algorithm;
+    int n;                          // Order of the cube, 1 to 32
+    int diagonals;                  // Plane diagonals checked: 0 none, 1 x-y slices, 2 all slices
+    unsigned long long seed;
+    double initial_temperature;
+    double alpha;
+    int max_sideways;
+    int max_restarts;
+    int population;
+    double mutation_rate;
+    long long trace_capacity;       // Steps whose current error is recorded, 0 for no trace
+    double move_mix[CUBE_SOLVER_MOVE_KINDS];  // Relative probability of each move kind (stochastic, annealing)
+    int tournament_size;            // Individuals competing in one tournament (genetic)
+} CubeSolverParams;
+
+typedef struct CubeSolver CubeSolver;
+
+// Fill params with the defaults of the single-run programs for an algorithm
+void cube_solver_default_params(CubeSolverParams *params, CubeSolverAlgorithm algorithm);
+
+// Create a solver from a random cube, returns NULL on invalid parameters or out of memory
+CubeSolver *cube_solver_create(const CubeSolverParams *params);
+
+// Run up to iterations steps, returns the number done (less when the solver finished)
+long long cube_solver_step(CubeSolver *solver, long long iterations);
+
+// Continue the search from a given cube, n^3 values forming a permutation of 1..n^3, as if it had
+// just been created from it: the temperature, sideways moves and plateau start over, the step,
+// restart counts and trace go on. Returns 0 (solver unchanged) for a genetic solver or when
+// cells is not a permutation
+int cube_solver_set_cube(CubeSolver *solver, const int *cells);
+
+// Individual index of a genetic solver's current population, NULL for other algorithms or an
+// index out of range; *error is set to its error when error is not NULL
+const int *cube_solver_individual(const CubeSolver *solver, int index, long long *error);
+
+// Best cube found so far, n^3 values in i * n * n + j * n + k order, owned by the solver
+const int *cube_solver_best(const CubeSolver *solver);
+
+// Error of the best cube found so far, in units of the objective the library was built with
+long long cube_solver_error(const CubeSolver *solver);
+
+// Sum of |line sum - magic number| of the best cube, whatever the objective
+long long cube_solver_deviation(const CubeSolver *solver);
+
+// Error of the cube the search is currently at
+long long cube_solver_current_error(const CubeSolver *solver);
+
+// Current error after every recorded step, *length is set to the number of entries
+const long long *cube_solver_trace(const CubeSolver *solver, long long *length);
+
+// Steps done so far
+long long cube_solver_iterations(const CubeSolver *solver);
+
+// Number of restarts done (restart algorithm only)
+int cube_solver_restarts(const CubeSolver *solver);
+
+// 1 once the solver cannot make progress any more (solved, local optimum or limit reached)
+int cube_solver_done(const CubeSolver *solver);
+
+// Release every resource of a solver
+void cube_solver_destroy(CubeSolver *solver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+// Move library for cube.h cubes: swaps, 3-cycles, line rotations and swaps of parallel lines or slices
+//
+// A move is packed in one 64-bit word (kind in the low 3 bits, then its operands), so a
+// solver can store, compare or log moves without pointers. Every move is expanded into the
+// cells it changes and their new values, and move_delta() adds the change of every line
+// touched once, so its cost is O(affected lines) whatever the kind:
+//   MOVE_SWAP         two cells
+//   MOVE_CYCLE        three cells rotate their values a <- c <- b <- a
+//   MOVE_ROTATE       the values of one line shift along it, that line keeps its sum
+//   MOVE_LINE_SWAP    two parallel straight lines trade their values cell by cell; both lines keep
+//                     their sums (traded) and so does every line crossing both of them
+//   MOVE_SLICE_SWAP   two parallel slices trade their values; every line inside a slice keeps its sum
+// The larger moves change many cells at once while most sums stay put, which helps to get off
+// the deep plateaus near the end of a search where single swaps all make things worse.
+#ifndef MOVES_H
+#define MOVES_H
+
+#include "cube.h"
+
+#define MOVE_SWAP 0
+#define MOVE_CYCLE 1
+#define MOVE_ROTATE 2
+#define MOVE_LINE_SWAP 3
+#define MOVE_SLICE_SWAP 4
+#define MOVE_KINDS 5
+
+#define MOVE_FIELD_BITS 20  // Cells and lines of a cube up to CUBE_MAX_ORDER fit in 20 bits
+
+typedef unsigned long long CubeMove;
+
+// Scratch space of one thread for expanding and scoring moves on cubes of one order
+typedef struct {
+    int *cells;             // Cells changed by the move
+    int *values;            // Their new values
+    long long *line_change; // Change of the sum of every line, valid where line_mark == epoch
+    int *line_mark;
+    int *touched;           // Lines changed by the move
+    int epoch;
+} MoveScratch;
+
+// Pack a move kind and up to three operands
+static inline CubeMove move_encode(int kind, int x, int y, int z) {
+    return (CubeMove)kind | (CubeMove)x << 3 | (CubeMove)y << (3 + MOVE_FIELD_BITS)
+           | (CubeMove)z << (3 + 2 * MOVE_FIELD_BITS);
+}
+
+static inline int move_kind(CubeMove move) {
+    return (int)(move & 7);
+}
+
+// Operand 0, 1 or 2 of a move
+static inline int move_operand(CubeMove move, int index) {
+    return (int)(move >> (3 + index * MOVE_FIELD_BITS) & ((1 << MOVE_FIELD_BITS) - 1));
+}
+
+// Allocate the scratch space for cubes like cube, returns 0 when out of memory
+static inline int move_scratch_init(MoveScratch *scratch, const Cube *cube) {
+    memset(scratch, 0, sizeof(MoveScratch));
+    scratch->cells = malloc(sizeof(int) * 2 * cube->total);
+    scratch->values = malloc(sizeof(int) * 2 * cube->total);
+    scratch->line_change = calloc(cube->num_lines, sizeof(long long));
+    scratch->line_mark = calloc(cube->num_lines, sizeof(int));
+    scratch->touched = malloc(sizeof(int) * cube->num_lines);
+    return scratch->cells != NULL && scratch->values != NULL && scratch->line_change != NULL
+           && scratch->line_mark != NULL && scratch->touched != NULL;
+}
+
+// Release the scratch space
+static inline void move_scratch_free(MoveScratch *scratch) {
+    free(scratch->cells);
+    free(scratch->values);
+    free(scratch->line_change);
+    free(scratch->line_mark);
+    free(scratch->touched);
+    memset(scratch, 0, sizeof(MoveScratch));
+}
+
+// Cells changed by a move and their new values, returns how many
+static inline int move_expand(const Cube *cube, CubeMove move, int cells[], int values[]) {
+    int n = cube->n, count = 0;
+    int x = move_operand(move, 0), y = move_operand(move, 1), z = move_operand(move, 2);
+
+    switch (move_kind(move)) {
+        case MOVE_SWAP:
+            cells[0] = x; values[0] = cube->cells[y];
+            cells[1] = y; values[1] = cube->cells[x];
+            return 2;
+        case MOVE_CYCLE:
+            cells[0] = x; values[0] = cube->cells[z];
+            cells[1] = y; values[1] = cube->cells[x];
+            cells[2] = z; values[2] = cube->cells[y];
+            return 3;
+        case MOVE_ROTATE:
+            for (int s = 0; s < n; s++) {
+                cells[count] = cube->line_cells[x * n + s];
+                values[count++] = cube->cells[cube->line_cells[x * n + (s + y) % n]];
+            }
+            return count;
+        case MOVE_LINE_SWAP:
+            for (int s = 0; s < n; s++) {
+                int a = cube->line_cells[x * n + s], b = cube->line_cells[y * n + s];
+                cells[count] = a; values[count++] = cube->cells[b];
+                cells[count] = b; values[count++] = cube->cells[a];
+            }
+            return count;
+        case MOVE_SLICE_SWAP:
+            // x is the axis (0: i, 1: j, 2: k), y and z the two slices along it
+            for (int u = 0; u < n; u++) {
+                for (int v = 0; v < n; v++) {
+                    int a = x == 0 ? y * n * n + u * n + v : x == 1 ? u * n * n + y * n + v : u * n * n + v * n + y;
+                    int b = x == 0 ? z * n * n + u * n + v : x == 1 ? u * n * n + z * n + v : u * n * n + v * n + z;
+                    cells[count] = a; values[count++] = cube->cells[b];
+                    cells[count] = b; values[count++] = cube->cells[a];
+                }
+            }
+            return count;
+    }
+    return 0;
+}
+
+// Error change of a move, the cube is left untouched
+static inline long long move_delta(const Cube *cube, MoveScratch *scratch, CubeMove move) {
+    int count = move_expand(cube, move, scratch->cells, scratch->values);
+    int touched = 0;
+    long long delta = 0;
+
+    if (move_kind(move) == MOVE_SWAP) {
+        return cube_swap_delta(cube, scratch->cells[0], scratch->cells[1]);
+    }
+
+    // Sum the change of every line over the cells, a line is scored once however many it holds
+    scratch->epoch++;
+    for (int m = 0; m < count; m++) {
+        int cell = scratch->cells[m];
+        int change = scratch->values[m] - cube->cells[cell];
+        if (change == 0) continue;
+        for (int l = cube->line_start[cell]; l < cube->line_start[cell + 1]; l++) {
+            int line = cube->lines[l];
+            if (scratch->line_mark[line] != scratch->epoch) {
+                scratch->line_mark[line] = scratch->epoch;
+                scratch->line_change[line] = 0;
+                scratch->touched[touched++] = line;
+            }
+            scratch->line_change[line] += change;
+        }
+    }
+    for (int t = 0; t < touched; t++) {
+        int line = scratch->touched[t];
+        if (scratch->line_change[line] != 0) {
+            delta += objective_line_delta(cube->line_sum[line] - cube->magic, scratch->line_change[line],
+                                          objective_line_class(line, cube->n));
+        }
+    }
+    return delta;
+}
+
+// Apply a move whose delta is known and update the line sums, positions and error
+static inline void move_apply(Cube *cube, MoveScratch *scratch, CubeMove move, long long delta) {
+    int count = move_expand(cube, move, scratch->cells, scratch->values);
+
+    for (int m = 0; m < count; m++) {
+        int cell = scratch->cells[m];
+        int change = scratch->values[m] - cube->cells[cell];
+        for (int l = cube->line_start[cell]; l < cube->line_start[cell + 1]; l++) {
+            cube->line_sum[cube->lines[l]] += change;
+        }
+    }
+    for (int m = 0; m < count; m++) {
+        cube->cells[scratch->cells[m]] = scratch->values[m];
+        cube->position[scratch->values[m]] = scratch->cells[m];
+    }
+    cube->error += delta;
+}
+
+// Draw a random move, kinds picked with the probabilities in mix (MOVE_KINDS weights,
+// normalised here; NULL: swaps only)
+static inline CubeMove move_random(const Cube *cube, unsigned long long *rng, const double mix[]) {
+    int kind = MOVE_SWAP;
+    int n = cube->n;
+
+    if (mix != NULL && n >= 2) {
+        double total = 0, pick;
+        for (int k = 0; k < MOVE_KINDS; k++) total += mix[k];
+        pick = cube_rand_double(rng) * total;
+        for (kind = 0; kind < MOVE_KINDS - 1 && pick >= mix[kind]; kind++) {
+            pick -= mix[kind];
+        }
+    }
+
+    switch (kind) {
+        case MOVE_CYCLE: {
+            int a = cube_rand_int(rng, cube->total), b = cube_rand_int(rng, cube->total - 1);
+            int c = cube_rand_int(rng, cube->total - 2);
+            b += b >= a;  // Three distinct cells
+            if (c >= (a < b ? a : b)) c++;
+            if (c >= (a < b ? b : a)) c++;
+            return move_encode(MOVE_CYCLE, a, b, c);
+        }
+        case MOVE_ROTATE:
+            return move_encode(MOVE_ROTATE, cube_rand_int(rng, cube->num_lines), 1 + cube_rand_int(rng, n - 1), 0);
+        case MOVE_LINE_SWAP: {
+            // Straight lines are interleaved rows, columns, pillars: 3 * (a * n + b) + family
+            int family = cube_rand_int(rng, 3);
+            int first = cube_rand_int(rng, n * n), second = cube_rand_int(rng, n * n - 1);
+            second += second >= first;
+            return move_encode(MOVE_LINE_SWAP, 3 * first + family, 3 * second + family, 0);
+        }
+        case MOVE_SLICE_SWAP: {
+            int first = cube_rand_int(rng, n), second = cube_rand_int(rng, n - 1);
+            second += second >= first;
+            return move_encode(MOVE_SLICE_SWAP, cube_rand_int(rng, 3), first, second);
+        }
+    }
+    return move_encode(MOVE_SWAP, cube_rand_int(rng, cube->total), cube_rand_int(rng, cube->total), 0);
+}
+
+#endif
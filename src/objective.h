@@ -0,0 +1,103 @@
+// Objective functions over line deviations, chosen at build time
+//
+// A line whose sum is off by d from the magic number costs:
+//   OBJECTIVE_ABSOLUTE  |d|, the original objective of every program
+//   OBJECTIVE_SQUARED   d^2, one badly broken line weighs more than many nearly right ones
+//   OBJECTIVE_VIOLATED  1 for every line that is off, however far
+//   OBJECTIVE_WEIGHTED  |d| times the weight of the line class (straight lines, space diagonals,
+//                       plane diagonals), OBJECTIVE_WEIGHT_* below
+// Every objective is 0 exactly for a magic cube. The cost of a line and its change under a swap
+// are static inline functions of a compile-time choice, so a swap-delta kernel built on
+// objective_line_delta() has no branch on the objective in its inner loop.
+//
+// All programs list their lines in the same order (rows, columns and pillars, then the two
+// space diagonals, then the plane diagonals) so the class of a line follows from its index.
+// Which plane diagonals exist stays the choice of each program (PLANE_DIAGONALS / diagonals).
+//
+// Select with e.g. gcc -DOBJECTIVE=OBJECTIVE_SQUARED ...; the error that is printed and
+// archived is always the absolute deviation, so runs with different objectives compare.
+#ifndef OBJECTIVE_H
+#define OBJECTIVE_H
+
+#include <stdlib.h>
+
+#define OBJECTIVE_ABSOLUTE 0
+#define OBJECTIVE_SQUARED 1
+#define OBJECTIVE_VIOLATED 2
+#define OBJECTIVE_WEIGHTED 3
+
+#ifndef OBJECTIVE
+#define OBJECTIVE OBJECTIVE_ABSOLUTE
+#endif
+
+#ifndef OBJECTIVE_WEIGHT_STRAIGHT
+#define OBJECTIVE_WEIGHT_STRAIGHT 1  // Rows, columns and pillars
+#endif
+#ifndef OBJECTIVE_WEIGHT_SPACE
+#define OBJECTIVE_WEIGHT_SPACE 4     // The two main space diagonals, each is the only line of its kind
+#endif
+#ifndef OBJECTIVE_WEIGHT_PLANE
+#define OBJECTIVE_WEIGHT_PLANE 2     // Diagonals of the slices
+#endif
+
+#define OBJECTIVE_STRAIGHT 0
+#define OBJECTIVE_SPACE 1
+#define OBJECTIVE_PLANE 2
+
+// Name of the objective the program was built with
+static inline const char *objective_name(void) {
+    static const char *names[] = {"absolute", "squared", "violated", "weighted"};
+    return names[OBJECTIVE];
+}
+
+// Class of line l of a cube of order n
+static inline int objective_line_class(int line, int n) {
+    return line < 3 * n * n ? OBJECTIVE_STRAIGHT : line < 3 * n * n + 2 ? OBJECTIVE_SPACE : OBJECTIVE_PLANE;
+}
+
+// Cost of a line off by deviation
+static inline long long objective_cost(long long deviation, int line_class) {
+#if OBJECTIVE == OBJECTIVE_SQUARED
+    (void)line_class;
+    return deviation * deviation;
+#elif OBJECTIVE == OBJECTIVE_VIOLATED
+    (void)line_class;
+    return deviation != 0;
+#elif OBJECTIVE == OBJECTIVE_WEIGHTED
+    static const long long weights[3] = {OBJECTIVE_WEIGHT_STRAIGHT, OBJECTIVE_WEIGHT_SPACE, OBJECTIVE_WEIGHT_PLANE};
+    return weights[line_class] * llabs(deviation);
+#else
+    (void)line_class;
+    return llabs(deviation);
+#endif
+}
+
+// Cost change of a line off by deviation when its sum moves by change
+static inline long long objective_line_delta(long long deviation, long long change, int line_class) {
+#if OBJECTIVE == OBJECTIVE_SQUARED
+    (void)line_class;
+    return change * (2 * deviation + change);
+#elif OBJECTIVE == OBJECTIVE_VIOLATED
+    (void)line_class;
+    return (deviation + change != 0) - (deviation != 0);
+#else
+    return objective_cost(deviation + change, line_class) - objective_cost(deviation, line_class);
+#endif
+}
+
+// Cost of a line for a program scoring whole cubes: the objective, or the absolute deviation that
+// is printed and archived when absolute is set
+static inline long long objective_score(long long deviation, int line_class, int absolute) {
+    return absolute ? llabs(deviation) : objective_cost(deviation, line_class);
+}
+
+// Sum of absolute deviations of a set of line sums, the error every program reports
+static inline int objective_deviation(const int line_sum[], int num_lines, int magic) {
+    int error = 0;
+    for (int l = 0; l < num_lines; l++) {
+        error += abs(line_sum[l] - magic);
+    }
+    return error;
+}
+
+#endif
@@ -1,14 +1,15 @@
+import os
+
 import matplotlib.pyplot as plt
 
-# Load data from acceptance_probs.txt
-iteration = []
-acceptance_probs = []
+from trace_loader import load_trace, load_text_trace
 
-with open("output/acceptance_probs.txt", "r") as f:
-    for line in f:
-        iter_num, prob = line.split()
-        iteration.append(int(iter_num))
-        acceptance_probs.append(float(prob))
+# Load data from acceptance_probs.trc (or the old acceptance_probs.txt)
+if os.path.exists("output/acceptance_probs.trc"):
+    trace = load_trace("output/acceptance_probs.trc")
+    iteration, acceptance_probs = trace["iteration"], trace["probability"]
+else:
+    iteration, acceptance_probs = load_text_trace("output/acceptance_probs.txt", [int, float])
 
 # Plot the data
 plt.plot(iteration, acceptance_probs)
@@ -16,4 +17,4 @@ plt.xlabel('Iteration')
 plt.ylabel(r'$e^{\Delta E / T}$')
 plt.title('Acceptance Probability vs Iterations')
 plt.grid(True)
-plt.show()
\ No newline at end of file
+plt.show()
@@ -1,15 +1,15 @@
+import os
+
 import matplotlib.pyplot as plt
 
-# Initialize lists to store data
-iterations = []
-errors = []
+from trace_loader import load_trace, load_text_trace
 
-# Load data from the objective_function.txt file
-with open("output/objective_function.txt", "r") as file:
-    for line in file:
-        iter_num, error = line.split()
-        iterations.append(int(iter_num))
-        errors.append(int(error))
+# Load data from objective_function.trc (or the old objective_function.txt)
+if os.path.exists("output/objective_function.trc"):
+    trace = load_trace("output/objective_function.trc")
+    iterations, errors = trace["iteration"], trace["error"]
+else:
+    iterations, errors = load_text_trace("output/objective_function.txt", [int, int])
 
 # Plot the data
 plt.plot(iterations, errors, marker='o', markersize=2, linestyle='-')
@@ -0,0 +1,175 @@
+import ctypes
+import os
+
+import numpy as np
+
+# Bindings to the solver library in src/cubesolver.c, built with
+#   gcc -O2 -fPIC -shared -o libcubesolver.so cubesolver.c -lm
+# ctypes releases the GIL for every library call, so solves in Python threads run in parallel.
+
+ALGORITHMS = ["steepest", "stochastic", "sideways", "restart", "annealing", "genetic"]
+
+
+class Params(ctypes.Structure):
+    _fields_ = [
+        ("algorithm", ctypes.c_int),
+        ("n", ctypes.c_int),
+        ("diagonals", ctypes.c_int),
+        ("seed", ctypes.c_ulonglong),
+        ("initial_temperature", ctypes.c_double),
+        ("alpha", ctypes.c_double),
+        ("max_sideways", ctypes.c_int),
+        ("max_restarts", ctypes.c_int),
+        ("population", ctypes.c_int),
+        ("mutation_rate", ctypes.c_double),
+        ("trace_capacity", ctypes.c_longlong),
+        ("move_mix", ctypes.c_double * 5),
+        ("tournament_size", ctypes.c_int),
+    ]
+
+
+def _load_library():
+    here = os.path.dirname(os.path.abspath(__file__))
+    candidates = [os.environ.get("CUBESOLVER_LIB"),
+                  os.path.join(here, "..", "libcubesolver.so"),
+                  os.path.join(here, "libcubesolver.so")]
+    for path in candidates:
+        if path and os.path.exists(path):
+            break
+    else:
+        raise OSError("libcubesolver.so not found, build it in src/ or set CUBESOLVER_LIB")
+
+    lib = ctypes.CDLL(path)
+    handle = ctypes.c_void_p
+    lib.cube_solver_default_params.argtypes = [ctypes.POINTER(Params), ctypes.c_int]
+    lib.cube_solver_default_params.restype = None
+    lib.cube_solver_create.argtypes = [ctypes.POINTER(Params)]
+    lib.cube_solver_create.restype = handle
+    lib.cube_solver_step.argtypes = [handle, ctypes.c_longlong]
+    lib.cube_solver_step.restype = ctypes.c_longlong
+    lib.cube_solver_best.argtypes = [handle]
+    lib.cube_solver_best.restype = ctypes.POINTER(ctypes.c_int)
+    lib.cube_solver_trace.argtypes = [handle, ctypes.POINTER(ctypes.c_longlong)]
+    lib.cube_solver_trace.restype = ctypes.POINTER(ctypes.c_longlong)
+    for name in ("cube_solver_error", "cube_solver_deviation", "cube_solver_current_error",
+                 "cube_solver_iterations"):
+        getattr(lib, name).argtypes = [handle]
+        getattr(lib, name).restype = ctypes.c_longlong
+    for name in ("cube_solver_restarts", "cube_solver_done"):
+        getattr(lib, name).argtypes = [handle]
+        getattr(lib, name).restype = ctypes.c_int
+    lib.cube_solver_destroy.argtypes = [handle]
+    lib.cube_solver_destroy.restype = None
+    return lib
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        _lib = _load_library()
+    return _lib
+
+
+class Solver:
+    """One solver handle. best() and trace() are numpy views over memory owned by the handle,
+    they stay valid (and keep the handle alive) as long as the arrays are referenced."""
+
+    def __init__(self, algorithm, n=5, seed=1, trace_capacity=0, **params):
+        self._lib = _library()
+        self.params = Params()
+        self._lib.cube_solver_default_params(ctypes.byref(self.params), ALGORITHMS.index(algorithm))
+        self.params.n = n
+        self.params.seed = seed
+        self.params.trace_capacity = trace_capacity
+        for key, value in params.items():
+            if not hasattr(self.params, key):
+                raise TypeError(f"unknown solver parameter {key}")
+            if key == "move_mix":
+                value = (ctypes.c_double * len(self.params.move_mix))(*value)
+            setattr(self.params, key, value)
+
+        self._handle = self._lib.cube_solver_create(ctypes.byref(self.params))
+        if not self._handle:
+            raise ValueError("invalid solver parameters or out of memory")
+
+    def step(self, iterations):
+        """Run up to iterations steps without holding the GIL, returns the number done."""
+        return self._lib.cube_solver_step(self._handle, iterations)
+
+    def run(self, iterations, chunk=1 << 16):
+        """Step until iterations are done or the solver stops."""
+        done = 0
+        while done < iterations:
+            stepped = self.step(min(chunk, iterations - done))
+            done += stepped
+            if stepped == 0 or self.done:
+                break
+        return done
+
+    def _view(self, pointer, ctype, length):
+        if length == 0:
+            return np.empty(0, dtype=np.dtype(ctype))
+        buffer = (ctype * length).from_address(ctypes.addressof(pointer.contents))
+        buffer._owner = self  # The array keeps the handle (and so the memory) alive
+        view = np.frombuffer(buffer, dtype=np.dtype(ctype))
+        view.flags.writeable = False
+        return view
+
+    def best(self):
+        """Best cube so far as an (n, n, n) int32 view, indexed [i, j, k]."""
+        n = self.params.n
+        return self._view(self._lib.cube_solver_best(self._handle), ctypes.c_int, n ** 3).reshape(n, n, n)
+
+    def trace(self):
+        """Current error after each recorded step as an int64 view."""
+        length = ctypes.c_longlong()
+        pointer = self._lib.cube_solver_trace(self._handle, ctypes.byref(length))
+        return self._view(pointer, ctypes.c_longlong, length.value)
+
+    @property
+    def error(self):
+        return self._lib.cube_solver_error(self._handle)
+
+    @property
+    def deviation(self):
+        """Absolute line deviation of the best cube, equal to error for the default objective."""
+        return self._lib.cube_solver_deviation(self._handle)
+
+    @property
+    def current_error(self):
+        return self._lib.cube_solver_current_error(self._handle)
+
+    @property
+    def iterations(self):
+        return self._lib.cube_solver_iterations(self._handle)
+
+    @property
+    def restarts(self):
+        return self._lib.cube_solver_restarts(self._handle)
+
+    @property
+    def done(self):
+        return bool(self._lib.cube_solver_done(self._handle))
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            self._lib.cube_solver_destroy(self._handle)
+            self._handle = None
+
+
+def default_params(algorithm):
+    """Defaults of the single-run programs for an algorithm, as a dict of parameter values."""
+    params = Params()
+    _library().cube_solver_default_params(ctypes.byref(params), ALGORITHMS.index(algorithm))
+    return {name: list(getattr(params, name)) if name == "move_mix" else getattr(params, name)
+            for name, _ in Params._fields_}
+
+
+def solve(algorithm, iterations, n=5, seed=1, trace=True, **params):
+    """Run one solve and return the solver, read results with best(), trace() and error."""
+    solver = Solver(algorithm, n=n, seed=seed, trace_capacity=iterations if trace else 0, **params)
+    solver.run(iterations)
+    return solver
@@ -1,6 +1,13 @@
+import os
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
 import pandas as pd
 import matplotlib.pyplot as plt
 
+from trace_loader import load_trace
+
 # Corrected data
 data = {
     'Population': [1000] * 9 + [1500] * 3 + [2000] * 3 + [1000] * 3,
@@ -12,8 +19,48 @@ data = {
                   1056, 1086, 1118, 1140, 1128, 1158, 1096, 1200, 1076]
 }
 
+# Which GA the numbers come from, shown in the plot titles
+source = 'Genetic.c'
+
+# Use the trial summaries written by Genetic.c when they exist
+if os.path.exists("output/genetic_trials.trc"):
+    trials = load_trace("output/genetic_trials.trc")
+    data = {
+        'Population': trials['population'].astype(int),
+        'Iterations': trials['iterations'].astype(int),
+        'Time': trials['time'],
+        'Best Cost': trials['best_cost'].astype(int)
+    }
+
+# Run the sweep natively through the solver library with --run (solves run in parallel threads).
+# The library GA has no crossover and no adaptive mutation, so its costs are not Genetic.c's
+if "--run" in sys.argv:
+    from cubesolver import solve
+
+    def trial(setting):
+        population, iterations, seed = setting
+        start = time.time()
+        solver = solve("genetic", iterations, population=population, seed=seed, trace=False)
+        return population, iterations, time.time() - start, solver.error
+
+    settings = [(p, i, seed) for p, i in [(1000, 5000), (1000, 50000), (1000, 75000),
+                                          (1500, 5000), (2000, 5000)] for seed in (1, 2, 3)]
+    with ThreadPoolExecutor(max_workers=os.cpu_count()) as pool:
+        results = list(pool.map(trial, settings))
+    data = {
+        'Population': [r[0] for r in results],
+        'Iterations': [r[1] for r in results],
+        'Time': [r[2] for r in results],
+        'Best Cost': [r[3] for r in results]
+    }
+    source = 'library GA: tournament + mutation, no crossover'
+    print("Note: --run uses the solver library's GA (no crossover, fixed mutation rate), "
+          "its costs are not comparable with Genetic.c runs.")
+
 # Create a DataFrame
 df = pd.DataFrame(data)
+if 'Try' not in df:
+    df['Try'] = df.groupby(['Population', 'Iterations']).cumcount() + 1
 
 # Plot where Population is fixed (Population = 1000)
 df_pop_1000 = df[df['Population'] == 1000]
@@ -22,7 +69,7 @@ iterations_summary = df_pop_1000.groupby('Iterations')['Best Cost'].agg(['max',
 plt.figure(figsize=(10, 6))
 plt.plot(iterations_summary['Iterations'], iterations_summary['max'], marker='o', color='r', label='Max Best Cost')
 plt.plot(iterations_summary['Iterations'], iterations_summary['mean'], marker='s', color='b', label='Average Best Cost')
-plt.title('Objective Function Analysis (Population = 1000)')
+plt.title(f'Objective Function Analysis (Population = 1000, {source})')
 plt.xlabel('Iterations')
 plt.ylabel('Best Cost')
 plt.legend()
@@ -36,7 +83,7 @@ population_summary = df_iter_5000.groupby('Population')['Best Cost'].agg(['max',
 plt.figure(figsize=(10, 6))
 plt.plot(population_summary['Population'], population_summary['max'], marker='o', color='r', label='Max Best Cost')
 plt.plot(population_summary['Population'], population_summary['mean'], marker='s', color='b', label='Average Best Cost')
-plt.title('Objective Function Analysis (Iterations = 5000)')
+plt.title(f'Objective Function Analysis (Iterations = 5000, {source})')
 plt.xlabel('Population')
 plt.ylabel('Best Cost')
 plt.legend()
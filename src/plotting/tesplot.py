@@ -1,6 +1,10 @@
+import os
+
 import pandas as pd
 import matplotlib.pyplot as plt
 
+from trace_loader import load_trace
+
 # Define the data
 data = {
     'Population': [1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1000, 1500, 1500, 1500, 2000, 2000, 2000],
@@ -10,8 +14,20 @@ data = {
     'Best Cost': [1146, 1128, 1188, 902, 1000, 902, 816, 880, 788, 1106, 1160, 1160, 1080, 1068, 1130, 1178]
 }
 
+# Use the trial summaries written by Genetic.c when they exist
+if os.path.exists("output/genetic_trials.trc"):
+    trials = load_trace("output/genetic_trials.trc")
+    data = {
+        'Population': trials['population'].astype(int),
+        'Iterations': trials['iterations'].astype(int),
+        'Time': trials['time'],
+        'Best Cost': trials['best_cost'].astype(int)
+    }
+
 # Create a DataFrame
 df = pd.DataFrame(data)
+if 'Try' not in df:
+    df['Try'] = df.groupby(['Population', 'Iterations']).cumcount() + 1
 
 # Plot where Population is fixed (Population = 1000)
 df_pop_1000 = df[df['Population'] == 1000]
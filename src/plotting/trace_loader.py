@@ -0,0 +1,34 @@
+import struct
+
+import numpy as np
+
+# Layout written by src/trace.h. A column may have room for more rows than the header counts
+# (summary tables append in place), only its first `rows` values are mapped.
+TRACE_MAGIC = b"CUBETRC1"
+HEADER = struct.Struct("<8sIIQ")
+COLUMN = struct.Struct("<24s8sQ")
+
+
+def load_trace(path):
+    """Map every column of a .trc file into a read-only numpy array without copying."""
+    with open(path, "rb") as f:
+        magic, version, columns, rows = HEADER.unpack(f.read(HEADER.size))
+        if magic != TRACE_MAGIC:
+            raise ValueError(f"{path} is not a trace file")
+        descriptors = [COLUMN.unpack(f.read(COLUMN.size)) for _ in range(columns)]
+
+    trace = {}
+    for name, dtype, offset in descriptors:
+        name = name.rstrip(b"\0").decode()
+        dtype = np.dtype(dtype.rstrip(b"\0").decode())
+        if rows == 0:
+            trace[name] = np.empty(0, dtype=dtype)
+        else:
+            trace[name] = np.memmap(path, dtype=dtype, mode="r", offset=offset, shape=(rows,))
+    return trace
+
+
+def load_text_trace(path, dtypes):
+    """Fallback for the old whitespace-separated .txt traces."""
+    data = np.loadtxt(path, ndmin=2)
+    return [data[:, c].astype(dtype) for c, dtype in enumerate(dtypes)]
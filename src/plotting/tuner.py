@@ -0,0 +1,312 @@
+import argparse
+import json
+import math
+import os
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+
+from cubesolver import ALGORITHMS, Solver, default_params
+
+# Racing auto-tuner for the solver parameters (F-Race).
+#
+# A set of candidate configurations (the defaults plus random samples of the space below) is
+# solved on the same solver seeds one after the other, every run stopping after the same CPU time
+# budget. Once min_seeds seeds are done, the runs of the surviving configurations are ranked per
+# seed and a Friedman test checks whether they differ; if they do, the configurations whose rank
+# sum is significantly worse than the best one (Conover post-hoc test) are dropped. Bad
+# configurations are thus dropped after a few seeds, and the budget goes to the close ones.
+# Solves run in parallel Python threads, the library releases the GIL.
+#
+#   python tuner.py annealing --n 5 --budget 1.0 --configs 24 --seeds 40
+#
+# The budget is thread CPU time, so configurations stay comparable when there are more threads
+# than cores. The races run the library kernels, so the best configuration is printed as library
+# parameters; only where a single-run program runs the same kernel is it also given as #defines.
+
+# Tuned parameters of each algorithm: (name, sampling, low, high)
+#   log      log-uniform real          logint   log-uniform integer
+#   int      uniform integer           cooling  1 - alpha log-uniform, for geometric cooling rates
+SPACES = {
+    "annealing": [("initial_temperature", "log", 1.0, 10000.0),
+                  ("alpha", "cooling", 0.99, 0.9999999)],
+    "sideways": [("max_sideways", "logint", 10, 100000)],
+    "restart": [("max_restarts", "logint", 1, 10000)],
+    "genetic": [("population", "logint", 10, 2000),
+                ("mutation_rate", "log", 0.005, 0.3),
+                ("tournament_size", "int", 2, 10)],
+}
+
+# Single-run programs running the same kernel as the library: the program, the settings it needs
+# and one line per parameter. The library cools once per proposed swap, as Annealing.c does since
+# a batch of proposals only caches scores, so ALPHA carries over as it is. Both sideways searches
+# pick a random equal move into a state not visited on the current plateau
+C_PROGRAMS = {
+    "annealing": ("Annealing.c", "#define SCHEDULE SCHEDULE_GEOMETRIC",
+                  {"initial_temperature": "#define INITIAL_TEMPERATURE {}", "alpha": "#define ALPHA {}"}),
+    "sideways": ("Sideways.c", "#define PLATEAU_SEARCH 1",
+                 {"max_sideways": "#define MAX_SIDEWAYS_MOVES {}\n#define VISITED_CAPACITY {visited}"}),
+}
+
+# Why the other algorithms have no matching program
+DIFFERENT_KERNELS = {
+    "restart": "Restart.c only scores the x-y slice diagonals and can run iterated local search, the library "
+               "scores every slice diagonal",
+    "genetic": "Genetic.c breeds with line/slice crossover and can adapt its mutation rate, the library GA only "
+               "clones tournament winners and mutates them",
+}
+
+
+def gamma_q(a, x):
+    """Regularized upper incomplete gamma function Q(a, x)."""
+    if x <= 0:
+        return 1.0
+    log_prefix = a * math.log(x) - x - math.lgamma(a)
+    if x < a + 1:
+        # Series of P(a, x)
+        term = total = 1.0 / a
+        for k in range(1, 1000):
+            term *= x / (a + k)
+            total += term
+            if abs(term) < abs(total) * 1e-15:
+                break
+        return max(0.0, 1.0 - total * math.exp(log_prefix))
+    # Continued fraction of Q(a, x), modified Lentz
+    b = x + 1 - a
+    c = 1 / 1e-300
+    d = 1 / b
+    h = d
+    for k in range(1, 1000):
+        an = -k * (k - a)
+        b += 2
+        d = an * d + b
+        d = 1 / (d if abs(d) > 1e-300 else 1e-300)
+        c = b + an / c
+        c = c if abs(c) > 1e-300 else 1e-300
+        h *= d * c
+        if abs(d * c - 1) < 1e-15:
+            break
+    return math.exp(log_prefix) * h
+
+
+def beta_inc(a, b, x):
+    """Regularized incomplete beta function I_x(a, b)."""
+    if x <= 0:
+        return 0.0
+    if x >= 1:
+        return 1.0
+    if x > (a + 1) / (a + b + 2):
+        return 1.0 - beta_inc(b, a, 1 - x)
+    log_prefix = math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1 - x)
+    # Continued fraction, modified Lentz
+    c, d = 1.0, 1 - (a + b) * x / (a + 1)
+    d = 1 / (d if abs(d) > 1e-300 else 1e-300)
+    h = d
+    for m in range(1, 1000):
+        for numerator in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                          -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1 + numerator * d
+            d = 1 / (d if abs(d) > 1e-300 else 1e-300)
+            c = 1 + numerator / c
+            c = c if abs(c) > 1e-300 else 1e-300
+            h *= d * c
+        if abs(d * c - 1) < 1e-15:
+            break
+    return math.exp(log_prefix) * h / a
+
+
+def chi2_sf(x, df):
+    """P(X > x) for a chi-squared variable with df degrees of freedom."""
+    return gamma_q(df / 2, x / 2)
+
+
+def t_sf(t, df):
+    """P(T > t) for a Student t variable with df degrees of freedom, t >= 0."""
+    return 0.5 * beta_inc(df / 2, 0.5, df / (df + t * t))
+
+
+def t_critical(significance, df):
+    """Two-sided critical value of the t distribution, by bisection."""
+    low, high = 0.0, 1e3
+    for _ in range(100):
+        middle = (low + high) / 2
+        if 2 * t_sf(middle, df) > significance:
+            low = middle
+        else:
+            high = middle
+    return high
+
+
+def rank_rows(matrix):
+    """Rank every row from 1 (lowest value), tied values get their mean rank."""
+    less = (matrix[:, None, :] < matrix[:, :, None]).sum(axis=2)
+    equal = (matrix[:, None, :] == matrix[:, :, None]).sum(axis=2)
+    return less + (equal + 1) / 2
+
+
+def eliminate(errors, significance):
+    """Columns of errors (one row per seed, one column per configuration) significantly worse
+    than the best one: Friedman test, then the Conover post-hoc comparison with the best."""
+    seeds, k = errors.shape
+    if k < 2 or seeds < 2:
+        return []
+    ranks = rank_rows(errors)
+    rank_sums = ranks.sum(axis=0)
+    a = (ranks ** 2).sum()
+    c = seeds * k * (k + 1) ** 2 / 4
+    if a - c <= 0:
+        return []  # Every seed is a tie
+    statistic = (k - 1) * ((rank_sums - seeds * (k + 1) / 2) ** 2).sum() / (a - c)
+    if chi2_sf(statistic, k - 1) >= significance:
+        return []
+
+    best = rank_sums.min()
+    spread = 2 * seeds * (a - (rank_sums ** 2).sum() / seeds) / ((seeds - 1) * (k - 1))
+    if spread <= 0:
+        return [j for j in range(k) if rank_sums[j] > best]  # Same order on every seed
+    critical = t_critical(significance, (seeds - 1) * (k - 1)) * math.sqrt(spread)
+    return [j for j in range(k) if rank_sums[j] - best > critical]
+
+
+def sample_config(space, rng):
+    """One random configuration of a parameter space."""
+    config = {}
+    for name, sampling, low, high in space:
+        if sampling == "log":
+            value = math.exp(rng.uniform(math.log(low), math.log(high)))
+        elif sampling == "logint":
+            value = min(high, int(math.exp(rng.uniform(math.log(low), math.log(high + 1)))))
+        elif sampling == "int":
+            value = int(rng.integers(low, high + 1))
+        else:
+            value = 1 - math.exp(rng.uniform(math.log(1 - high), math.log(1 - low)))
+        config[name] = value
+    return config
+
+
+def run(algorithm, n, config, seed, budget):
+    """Solve once within budget seconds of thread CPU time, returns (error, iterations)."""
+    solver = Solver(algorithm, n=n, seed=seed, **config)
+    start = time.thread_time()
+    chunk = 1
+    while not solver.done:
+        before = time.thread_time()
+        solver.step(chunk)
+        now = time.thread_time()
+        if now - start >= budget:
+            break
+        if now - before < budget / 100:
+            chunk *= 2  # Few library calls per run, whatever one step costs
+    return solver.error, solver.iterations
+
+
+def race(algorithm, n=5, budget=1.0, configs=16, seeds=32, min_seeds=5, significance=0.05, threads=None,
+         rng_seed=1, log=print):
+    """Race configs configurations of an algorithm on up to seeds solver seeds and return the
+    best one as a dict with its mean error, the seeds it ran and every candidate's result."""
+    space = SPACES[algorithm]
+    rng = np.random.default_rng(rng_seed)
+    defaults = default_params(algorithm)
+    candidates = [{name: defaults[name] for name, *_ in space}]
+    candidates += [sample_config(space, rng) for _ in range(configs - 1)]
+
+    threads = threads or os.cpu_count()
+    errors = np.full((seeds, len(candidates)), np.nan)
+    iterations = np.zeros((seeds, len(candidates)))
+    alive = list(range(len(candidates)))
+    dropped_at = {}
+    done = 0
+
+    with ThreadPoolExecutor(max_workers=threads) as pool:
+        while done < seeds and len(alive) > 1:
+            # Enough seeds per round to keep every thread busy
+            block = range(done, min(seeds, done + max(1, math.ceil(threads / len(alive)))))
+            jobs = [(s, c) for s in block for c in alive]
+            results = pool.map(lambda job: run(algorithm, n, candidates[job[1]], job[0] + 1, budget), jobs)
+            for (s, c), (error, steps) in zip(jobs, results):
+                errors[s, c] = error
+                iterations[s, c] = steps
+            done = block.stop
+
+            if done >= min_seeds:
+                dropped = [alive[j] for j in eliminate(errors[:done][:, alive], significance)]
+                for c in dropped:
+                    dropped_at[c] = done
+                alive = [c for c in alive if c not in dropped]
+                if dropped:
+                    log(f"After {done} seeds: {len(dropped)} dropped, {len(alive)} configurations left")
+
+    # Best survivor by rank over the seeds all survivors ran, then by mean error
+    ranks = rank_rows(errors[:done][:, alive]).mean(axis=0)
+    means = errors[:done][:, alive].mean(axis=0)
+    best = alive[min(range(len(alive)), key=lambda j: (ranks[j], means[j]))]
+
+    summary = []
+    for c, config in enumerate(candidates):
+        ran = dropped_at.get(c, done)
+        summary.append({"config": config, "seeds": ran, "mean_error": float(np.mean(errors[:ran, c])),
+                        "mean_iterations": float(np.mean(iterations[:ran, c])), "survived": c in alive})
+    return {"algorithm": algorithm, "n": n, "budget": budget, "best": candidates[best],
+            "mean_error": summary[best]["mean_error"], "seeds": done, "survivors": len(alive),
+            "candidates": summary}
+
+
+def format_value(value):
+    """A value as a C literal, reals keep a decimal point."""
+    if isinstance(value, int):
+        return str(value)
+    text = f"{value:.8g}"
+    return text if any(ch in text for ch in ".e") else text + ".0"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Race solver configurations and print the best one")
+    parser.add_argument("algorithm", choices=[a for a in ALGORITHMS if a in SPACES])
+    parser.add_argument("--n", type=int, default=5, help="order of the cube")
+    parser.add_argument("--budget", type=float, default=1.0, help="CPU seconds per solve")
+    parser.add_argument("--configs", type=int, default=16, help="candidate configurations, the defaults included")
+    parser.add_argument("--seeds", type=int, default=32, help="solver seeds at most")
+    parser.add_argument("--min-seeds", type=int, default=5, help="seeds before the first test")
+    parser.add_argument("--significance", type=float, default=0.05)
+    parser.add_argument("--threads", type=int, default=None, help="parallel solves (default: one per core)")
+    parser.add_argument("--rng-seed", type=int, default=1, help="seed of the configuration sampling")
+    parser.add_argument("--output", help="write the full result as JSON")
+    args = parser.parse_args()
+
+    start = time.time()
+    result = race(args.algorithm, args.n, args.budget, args.configs, args.seeds, args.min_seeds,
+                  args.significance, args.threads, args.rng_seed)
+
+    print(f"\n{'Configuration':<66} {'Seeds':>6} {'Mean error':>11} {'Iterations':>12}")
+    for candidate in sorted(result["candidates"], key=lambda c: (-c["seeds"], c["mean_error"])):
+        text = ", ".join(f"{name}={format_value(value)}" for name, value in candidate["config"].items())
+        print(f"{text:<66} {candidate['seeds']:>6} {candidate['mean_error']:>11.1f} "
+              f"{candidate['mean_iterations']:>12.0f}{'' if candidate['survived'] else '  dropped'}")
+
+    print(f"\nBest library parameters for {args.algorithm}, n={args.n}, {args.budget:g} s per solve "
+          f"({result['seeds']} seeds, {result['survivors']} survivors, {time.time() - start:.1f} s):")
+    for name, *_ in SPACES[args.algorithm]:
+        print(f"  {name} = {format_value(result['best'][name])}")
+    print(f"Mean error: {result['mean_error']:.1f}")
+
+    if args.algorithm in C_PROGRAMS:
+        program, setting, lines = C_PROGRAMS[args.algorithm]
+        print(f"\nThe same kernel in {program}:")
+        print(f"#define N {args.n}")
+        print(setting)
+        for name, line in lines.items():
+            value = result["best"][name]
+            visited = 1 << (2 * int(value) + 2).bit_length()  # Power of two > 2 * MAX_SIDEWAYS_MOVES
+            print(line.format(format_value(value), visited=visited))
+    else:
+        print(f"\nNo single-run program runs this kernel: {DIFFERENT_KERNELS[args.algorithm]}.")
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(result, f, indent=2)
+        print(f"Result stored in '{args.output}'.")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,197 @@
+// Live telemetry of a running solver in a POSIX shared-memory segment
+//
+// A solver creates /dev/shm/cube-telemetry-<pid> with one slot per search thread and publishes
+// its progress there every few thousand iterations. Each slot is a seqlock: the owner thread
+// makes the sequence odd, writes the fields and makes it even again, so publishing never waits
+// for a reader. A reader copies the slot and retries while the sequence is odd or has changed,
+// a bounded number of times: a writer killed mid-update leaves its sequence odd for good.
+// Watch.c lists every segment on the machine, shows rates and flags stalled runs.
+//
+// Publishing is best effort: when the segment cannot be created every call is a no-op. A run
+// stopped by SIGTERM (Watch --kill-stalled) or SIGINT removes its segment before it dies.
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define TELEMETRY_MAGIC 0x454C455445425543ULL  // "CUBETELE" in little-endian byte order
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PREFIX "cube-telemetry-"
+#define TELEMETRY_MAX_THREADS 64
+#define TELEMETRY_READ_RETRIES 1000    // Copies of a slot tried before telemetry_read() gives up
+
+#define TELEMETRY_IDLE 0
+#define TELEMETRY_RUNNING 1
+#define TELEMETRY_DONE 2
+
+// Progress of one search thread, on its own cache lines so threads never share one
+typedef struct {
+    uint32_t sequence;          // Odd while the owner is writing
+    int32_t status;             // TELEMETRY_IDLE, TELEMETRY_RUNNING or TELEMETRY_DONE
+    char label[24];             // What the thread is running, e.g. the strategy
+    int64_t iterations;
+    int64_t current_error;
+    int64_t best_error;
+    int64_t restarts;           // Restarts, reheats, kicks or plateaus, whatever the solver counts
+    double temperature;
+    double updated;             // CLOCK_MONOTONIC seconds of the last publish
+    double improved;            // CLOCK_MONOTONIC seconds when best_error last went down
+} __attribute__((aligned(64))) TelemetrySlot;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    int32_t pid;
+    int32_t threads;
+    char program[28];
+    double started;             // CLOCK_MONOTONIC seconds when the segment was created
+    TelemetrySlot slots[TELEMETRY_MAX_THREADS];
+} TelemetrySegment;
+
+// Name of the segment of this process while it is open, for the signal handler
+static char telemetry_name[64];
+
+// Remove the segment, then die of the same signal with the default action
+static inline void telemetry_on_signal(int signal_number) {
+    if (telemetry_name[0] != '\0') {
+        shm_unlink(telemetry_name);
+    }
+    signal(signal_number, SIG_DFL);
+    raise(signal_number);
+}
+
+// CLOCK_MONOTONIC in seconds, the same clock for every process on the machine
+static inline double telemetry_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Create the segment of this process, returns NULL when shared memory is not available
+static inline TelemetrySegment *telemetry_open(const char *program, int threads) {
+    char name[64];
+    snprintf(name, sizeof(name), "/" TELEMETRY_PREFIX "%d", (int)getpid());
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(TelemetrySegment)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    TelemetrySegment *segment = mmap(NULL, sizeof(TelemetrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    segment->version = TELEMETRY_VERSION;
+    segment->pid = (int32_t)getpid();
+    segment->threads = threads < TELEMETRY_MAX_THREADS ? threads : TELEMETRY_MAX_THREADS;
+    snprintf(segment->program, sizeof(segment->program), "%s", program);
+    segment->started = telemetry_now();
+    for (int t = 0; t < segment->threads; t++) {
+        segment->slots[t].best_error = -1;
+        segment->slots[t].current_error = -1;
+    }
+    __atomic_store_n(&segment->magic, TELEMETRY_MAGIC, __ATOMIC_RELEASE);  // Readers skip half-built segments
+
+    // Unlink on SIGTERM and SIGINT, unless the program handles them itself
+    struct sigaction action, previous;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = telemetry_on_signal;
+    sigemptyset(&action.sa_mask);
+    snprintf(telemetry_name, sizeof(telemetry_name), "%s", name);
+    int signals[] = {SIGTERM, SIGINT};
+    for (int s = 0; s < 2; s++) {
+        if (sigaction(signals[s], NULL, &previous) == 0 && previous.sa_handler == SIG_DFL) {
+            sigaction(signals[s], &action, NULL);
+        }
+    }
+    return segment;
+}
+
+// Publish the progress of one thread without blocking; only that thread writes its slot
+static inline void telemetry_publish(TelemetrySegment *segment, int thread, const char *label, int64_t iterations,
+                                     int64_t current_error, int64_t best_error, double temperature,
+                                     int64_t restarts) {
+    if (segment == NULL || thread >= segment->threads) {
+        return;
+    }
+    TelemetrySlot *slot = &segment->slots[thread];
+    uint32_t sequence = slot->sequence;
+    double now = telemetry_now();
+
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (slot->best_error < 0 || best_error < slot->best_error) {
+        slot->improved = now;
+    }
+    slot->status = TELEMETRY_RUNNING;
+    size_t length = strnlen(label, sizeof(slot->label) - 1);  // Long labels, e.g. job ids, are cut
+    memcpy(slot->label, label, length);
+    slot->label[length] = '\0';
+    slot->iterations = iterations;
+    slot->current_error = current_error;
+    slot->best_error = best_error;
+    slot->restarts = restarts;
+    slot->temperature = temperature;
+    slot->updated = now;
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// Mark a thread idle or done
+static inline void telemetry_status(TelemetrySegment *segment, int thread, int status) {
+    if (segment == NULL || thread >= segment->threads) {
+        return;
+    }
+    TelemetrySlot *slot = &segment->slots[thread];
+    uint32_t sequence = slot->sequence;
+
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->status = status;
+    slot->updated = telemetry_now();
+    __atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// Copy a slot written by another process. Returns 1 for a consistent copy, 0 when the slot was
+// still being written after TELEMETRY_READ_RETRIES tries; the copy then holds the last attempt
+static inline int telemetry_read(const TelemetrySegment *segment, int thread, TelemetrySlot *copy) {
+    const TelemetrySlot *slot = &segment->slots[thread];
+
+    for (int tries = 0; tries < TELEMETRY_READ_RETRIES; tries++) {
+        uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        memcpy(copy, slot, sizeof(TelemetrySlot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t after = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+        if (!(before & 1) && before == after) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Remove the segment, a reader that still has it mapped keeps its last state
+static inline void telemetry_close(TelemetrySegment *segment) {
+    char name[64];
+
+    if (segment == NULL) {
+        return;
+    }
+    snprintf(name, sizeof(name), "/" TELEMETRY_PREFIX "%d", (int)segment->pid);
+    telemetry_name[0] = '\0';
+    munmap(segment, sizeof(TelemetrySegment));
+    shm_unlink(name);
+}
+
+#endif
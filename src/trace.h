@@ -0,0 +1,196 @@
+// Columnar binary format for solver traces and trial summaries
+//
+// A trace file is a fixed header, one descriptor per column, then every column stored as
+// one contiguous typed array starting on a 64-byte boundary. The plotting scripts map the
+// columns straight into numpy arrays (see plotting/trace_loader.py) without parsing text.
+//
+//   header:     char magic[8] = "CUBETRC1", uint32 version, uint32 columns, uint64 rows
+//   descriptor: char name[24], char dtype[8] (numpy type string, e.g. "<i4", "<f8"), uint64 offset
+//
+// A column may have room for more rows than the header counts: its slack runs up to the next
+// column (or the end of the file). Summary tables use it to append a row in place, under an
+// exclusive flock() so several solver processes can share one table, and only lay the file out
+// again with twice the room when a column is full. Readers take the first rows values of each column.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#define TRACE_MAGIC "CUBETRC1"
+#define TRACE_VERSION 1
+#define TRACE_ALIGN 64
+#define TRACE_MAX_COLUMNS 16
+#define TRACE_INITIAL_ROWS 64       // Room of a new summary table, doubled whenever it fills up
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t columns;
+    uint64_t rows;
+} TraceHeader;
+
+typedef struct {
+    char name[24];
+    char dtype[8];
+    uint64_t offset;
+} TraceColumn;
+
+// Size in bytes of one value of a numpy type string such as "<i4" or "<f8"
+static inline size_t trace_dtype_size(const char *dtype) {
+    return (size_t)atoi(dtype + 2);
+}
+
+// Round an offset up to the column alignment
+static inline uint64_t trace_align(uint64_t offset) {
+    return (offset + TRACE_ALIGN - 1) / TRACE_ALIGN * TRACE_ALIGN;
+}
+
+// Lay out a table in an open file with room for capacity rows per column, data[c] points to rows
+// values of type dtypes[c]; returns 0 on failure
+static inline int trace_write_fd(int fd, uint64_t rows, uint64_t capacity, int columns, const char *names[],
+                                 const char *dtypes[], const void *data[]) {
+    TraceHeader header;
+    TraceColumn descriptors[TRACE_MAX_COLUMNS];
+
+    if (columns < 1 || columns > TRACE_MAX_COLUMNS || ftruncate(fd, 0) != 0) {
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, 8);
+    header.version = TRACE_VERSION;
+    header.columns = (uint32_t)columns;
+    header.rows = rows;
+
+    // Lay out the columns one after another, each aligned
+    uint64_t offset = trace_align(sizeof(TraceHeader) + columns * sizeof(TraceColumn));
+    memset(descriptors, 0, sizeof(descriptors));
+    for (int c = 0; c < columns; c++) {
+        snprintf(descriptors[c].name, sizeof(descriptors[c].name), "%s", names[c]);
+        snprintf(descriptors[c].dtype, sizeof(descriptors[c].dtype), "%s", dtypes[c]);
+        descriptors[c].offset = offset;
+        offset = trace_align(offset + capacity * trace_dtype_size(dtypes[c]));
+    }
+    uint64_t end = descriptors[columns - 1].offset + capacity * trace_dtype_size(dtypes[columns - 1]);
+
+    // The gaps stay holes of zeros, the file ends with the room of the last column
+    int ok = ftruncate(fd, (off_t)end) == 0
+             && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+             && pwrite(fd, descriptors, columns * sizeof(TraceColumn), sizeof(header))
+                == (ssize_t)(columns * sizeof(TraceColumn));
+    for (int c = 0; c < columns && ok; c++) {
+        size_t size = rows * trace_dtype_size(dtypes[c]);
+        ok = size == 0 || pwrite(fd, data[c], size, (off_t)descriptors[c].offset) == (ssize_t)size;
+    }
+    return ok;
+}
+
+// Write a whole table, data[c] points to rows values of type dtypes[c]; returns 0 on failure
+static inline int trace_write(const char *path, uint64_t rows, int columns, const char *names[],
+                              const char *dtypes[], const void *data[]) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+    int ok = trace_write_fd(fd, rows, rows, columns, names, dtypes, data);
+    close(fd);
+    return ok;
+}
+
+// Rows every column of a table can hold, 0 unless it is a table of doubles with these columns
+static inline uint64_t trace_row_capacity(int fd, const TraceHeader *header, const TraceColumn descriptors[],
+                                          int columns, const char *names[]) {
+    struct stat st;
+    uint64_t capacity = UINT64_MAX;
+
+    if (fstat(fd, &st) != 0 || memcmp(header->magic, TRACE_MAGIC, 8) != 0 || header->version != TRACE_VERSION
+        || header->columns != (uint32_t)columns) {
+        return 0;
+    }
+    for (int c = 0; c < columns; c++) {
+        uint64_t end = c + 1 < columns ? descriptors[c + 1].offset : (uint64_t)st.st_size;
+        if (strncmp(descriptors[c].name, names[c], sizeof(descriptors[c].name)) != 0
+            || strncmp(descriptors[c].dtype, "<f8", sizeof(descriptors[c].dtype)) != 0 || end < descriptors[c].offset) {
+            return 0;
+        }
+        uint64_t room = (end - descriptors[c].offset) / sizeof(double);
+        capacity = room < capacity ? room : capacity;
+    }
+    return capacity;
+}
+
+// Append one row of doubles to a summary table, creating it with the given columns if needed.
+// The row goes into the slack of every column, so an append costs O(columns); a full table is
+// laid out again with twice the room. A table with other columns is replaced by a new one.
+static inline int trace_append_row(const char *path, int columns, const char *names[], const double values[]) {
+    TraceHeader header;
+    TraceColumn descriptors[TRACE_MAX_COLUMNS];
+    uint64_t rows = 0, capacity = 0;
+    int ok = 0;
+
+    if (columns < 1 || columns > TRACE_MAX_COLUMNS) {
+        return 0;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+    flock(fd, LOCK_EX);
+
+    // Find out how many rows the existing table has and holds
+    if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)
+        && header.columns == (uint32_t)columns
+        && pread(fd, descriptors, columns * sizeof(TraceColumn), sizeof(header)) == (ssize_t)(columns * sizeof(TraceColumn))) {
+        capacity = trace_row_capacity(fd, &header, descriptors, columns, names);
+        rows = capacity > 0 && header.rows <= capacity ? header.rows : 0;
+    }
+
+    if (rows < capacity) {
+        // Fill the slack, then publish the row by bumping the count
+        ok = 1;
+        for (int c = 0; c < columns && ok; c++) {
+            off_t at = (off_t)(descriptors[c].offset + rows * sizeof(double));
+            ok = pwrite(fd, &values[c], sizeof(double), at) == (ssize_t)sizeof(double);
+        }
+        header.rows = rows + 1;
+        ok = ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    } else {
+        // Full (or new): read the rows back and lay the table out with twice the room
+        double *data[TRACE_MAX_COLUMNS];
+        const void *views[TRACE_MAX_COLUMNS];
+        const char *dtypes[TRACE_MAX_COLUMNS];
+        ok = 1;
+        for (int c = 0; c < columns; c++) {
+            data[c] = malloc(sizeof(double) * (rows + 1));
+            ok = ok && data[c] != NULL;
+        }
+        for (int c = 0; c < columns && ok && rows > 0; c++) {
+            ok = pread(fd, data[c], rows * sizeof(double), (off_t)descriptors[c].offset) == (ssize_t)(rows * sizeof(double));
+        }
+        if (ok) {
+            for (int c = 0; c < columns; c++) {
+                data[c][rows] = values[c];
+                views[c] = data[c];
+                dtypes[c] = "<f8";
+            }
+            uint64_t room = rows * 2 > TRACE_INITIAL_ROWS ? rows * 2 : TRACE_INITIAL_ROWS;
+            ok = trace_write_fd(fd, rows + 1, room, columns, names, dtypes, views);
+        }
+        for (int c = 0; c < columns; c++) {
+            free(data[c]);
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return ok;
+}
+
+#endif
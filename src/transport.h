@@ -0,0 +1,220 @@
+// Message passing between the processes of a distributed search
+//
+// One small interface with two backends, picked at build time:
+//   default          local: transport_init() forks `size` processes on this machine, each owning
+//                    a Unix datagram socket named after the launching process and its rank
+//   -DTRANSPORT_MPI  MPI: one process per rank of mpirun, messages go through MPI_Isend and
+//                    are picked up with MPI_Iprobe, so several nodes can take part
+// Both move opaque byte messages of up to TRANSPORT_MAX_MESSAGE bytes. Nothing here ever waits
+// for another process: transport_send() returns 0 and drops the message when it cannot leave
+// right away (the receiver's queue is full, or every MPI send buffer is still in flight), or -1
+// when the receiver is gone, and transport_receive() returns 0 when nothing has arrived. A search
+// polls between two units of work, so communication overlaps computation. A message that must
+// arrive is resent by the caller while transport_send() returns 0.
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TRANSPORT_MPI
+#include <mpi.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+#ifndef TRANSPORT_MAX_MESSAGE
+#define TRANSPORT_MAX_MESSAGE 16384     // Largest message in bytes
+#endif
+#define TRANSPORT_MAX_PROCESSES 256     // Processes started by the local backend
+#define TRANSPORT_SEND_SLOTS 16         // MPI sends in flight per process
+#define TRANSPORT_TAG 7
+
+typedef struct {
+    int rank;
+    int size;
+    long long sent;
+    long long dropped;                  // Messages transport_send() could not send
+    long long received;
+#ifdef TRANSPORT_MPI
+    MPI_Request requests[TRANSPORT_SEND_SLOTS];
+    unsigned char buffers[TRANSPORT_SEND_SLOTS][TRANSPORT_MAX_MESSAGE];
+    int next_slot;
+#else
+    int socket;
+    int session;                        // PID of the launching process, part of every socket name
+    int children[TRANSPORT_MAX_PROCESSES];
+#endif
+} Transport;
+
+#ifndef TRANSPORT_MPI
+// Abstract socket address of a rank, nothing is left behind in the file system
+static inline socklen_t transport_address(int session, int rank, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    int length = snprintf(address->sun_path + 1, sizeof(address->sun_path) - 1, "cube-transport-%d-%d", session, rank);
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+#endif
+
+// Start the transport. The local backend forks size - 1 copies of the calling process, which
+// return from here with their own rank; MPI takes the size from mpirun. Returns 0 on failure
+static inline int transport_init(Transport *transport, int *argc, char ***argv, int size) {
+    memset(transport, 0, sizeof(Transport));
+#ifdef TRANSPORT_MPI
+    (void)size;
+    if (MPI_Init(argc, argv) != MPI_SUCCESS) {
+        return 0;
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &transport->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &transport->size);
+    for (int s = 0; s < TRANSPORT_SEND_SLOTS; s++) {
+        transport->requests[s] = MPI_REQUEST_NULL;
+    }
+    return 1;
+#else
+    (void)argc;
+    (void)argv;
+    int sockets[TRANSPORT_MAX_PROCESSES];
+
+    if (size < 1 || size > TRANSPORT_MAX_PROCESSES) {
+        return 0;
+    }
+    transport->size = size;
+    transport->session = (int)getpid();
+
+    // Bind every socket before forking, so no message is sent to a rank that does not exist yet
+    for (int r = 0; r < size; r++) {
+        struct sockaddr_un address;
+        socklen_t length = transport_address(transport->session, r, &address);
+        sockets[r] = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (sockets[r] < 0 || bind(sockets[r], (struct sockaddr *)&address, length) != 0) {
+            for (int c = 0; c <= r; c++) {
+                if (sockets[c] >= 0) close(sockets[c]);
+            }
+            return 0;
+        }
+    }
+
+    fflush(stdout);  // Children would print the parent's buffered output again
+    for (int r = 1; r < size; r++) {
+        int pid = fork();
+        if (pid == 0) {
+            transport->rank = r;
+            break;
+        }
+        transport->children[r] = pid;
+        if (pid < 0) {
+            transport->size = r;  // Run with the ranks started so far
+            break;
+        }
+    }
+    for (int r = 0; r < size; r++) {
+        if (r != transport->rank) close(sockets[r]);
+    }
+    transport->socket = sockets[transport->rank];
+    return 1;
+#endif
+}
+
+// Send a message without waiting, returns 1 if it left, 0 if it was dropped and -1 if the
+// destination has exited (local backend only)
+static inline int transport_send(Transport *transport, int destination, const void *data, int length) {
+    if (length > TRANSPORT_MAX_MESSAGE || destination < 0 || destination >= transport->size) {
+        transport->dropped++;
+        return 0;
+    }
+#ifdef TRANSPORT_MPI
+    // Reuse the first send buffer whose message has left
+    for (int tries = 0; tries < TRANSPORT_SEND_SLOTS; tries++) {
+        int slot = (transport->next_slot + tries) % TRANSPORT_SEND_SLOTS;
+        int done = 1;
+        if (transport->requests[slot] != MPI_REQUEST_NULL) {
+            MPI_Test(&transport->requests[slot], &done, MPI_STATUS_IGNORE);
+        }
+        if (done) {
+            memcpy(transport->buffers[slot], data, length);
+            MPI_Isend(transport->buffers[slot], length, MPI_BYTE, destination, TRANSPORT_TAG, MPI_COMM_WORLD,
+                      &transport->requests[slot]);
+            transport->next_slot = (slot + 1) % TRANSPORT_SEND_SLOTS;
+            transport->sent++;
+            return 1;
+        }
+    }
+#else
+    struct sockaddr_un address;
+    socklen_t address_length = transport_address(transport->session, destination, &address);
+    if (sendto(transport->socket, data, length, MSG_DONTWAIT, (struct sockaddr *)&address, address_length) == length) {
+        transport->sent++;
+        return 1;
+    }
+    if (errno == ECONNREFUSED || errno == ENOENT) {
+        transport->dropped++;
+        return -1;
+    }
+#endif
+    transport->dropped++;
+    return 0;
+}
+
+// Take one message that has arrived, returns its length or 0 when there is none.
+// Messages longer than capacity are discarded
+static inline int transport_receive(Transport *transport, void *buffer, int capacity) {
+    while (1) {
+#ifdef TRANSPORT_MPI
+        int arrived, length;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, TRANSPORT_TAG, MPI_COMM_WORLD, &arrived, &status);
+        if (!arrived) {
+            return 0;
+        }
+        MPI_Get_count(&status, MPI_BYTE, &length);
+        if (length > capacity) {
+            static unsigned char discard[TRANSPORT_MAX_MESSAGE];
+            MPI_Recv(discard, TRANSPORT_MAX_MESSAGE, MPI_BYTE, status.MPI_SOURCE, TRANSPORT_TAG, MPI_COMM_WORLD,
+                     MPI_STATUS_IGNORE);
+            continue;
+        }
+        MPI_Recv(buffer, capacity, MPI_BYTE, status.MPI_SOURCE, TRANSPORT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+#else
+        ssize_t length = recv(transport->socket, buffer, capacity, MSG_DONTWAIT | MSG_TRUNC);  // Full length
+        if (length <= 0) {
+            return 0;
+        }
+        if (length > capacity) {
+            continue;
+        }
+#endif
+        transport->received++;
+        return (int)length;
+    }
+}
+
+// Stop the transport. MPI waits for the sends in flight and every rank; the launching process
+// of the local backend waits for its children
+static inline void transport_finalize(Transport *transport) {
+#ifdef TRANSPORT_MPI
+    unsigned char discard[TRANSPORT_MAX_MESSAGE];
+    MPI_Waitall(TRANSPORT_SEND_SLOTS, transport->requests, MPI_STATUSES_IGNORE);
+    MPI_Barrier(MPI_COMM_WORLD);
+    while (transport_receive(transport, discard, sizeof(discard)) > 0) {
+        // Migrants nobody is waiting for any more
+    }
+    MPI_Finalize();
+#else
+    close(transport->socket);
+    if (transport->rank == 0) {
+        for (int r = 1; r < transport->size; r++) {
+            waitpid(transport->children[r], NULL, 0);
+        }
+    }
+#endif
+}
+
+#endif